@@ -0,0 +1,604 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// Native benchmark driving processors through Codec<> without V8.
+// Built by `node-waf configure --with-bench build`, run as
+//   build/default/compress-bench [--size MB] [--codec NAME] [--corpus NAME]
+//                                [--file PATH] [--whole]
+// --whole passes each corpus in a single write instead of fixed chunks; with
+// --size above 4096 it checks sizes beyond 32 bits end to end, e.g.
+//   compress-bench --size 5000 --corpus text --codec gzip --whole
+// Emits one JSON object per measurement on stdout.
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WITH_GZIP
+#include "../src/gzip.cc"
+#endif
+
+#ifdef WITH_BZIP
+#include "../src/bzip.cc"
+#endif
+
+#ifdef WITH_LZ4
+#include "../src/lz4.cc"
+#endif
+
+#ifdef WITH_ZSTD
+#include "../src/zstd.cc"
+#endif
+
+#ifdef WITH_XZ
+#include "../src/xz.cc"
+#endif
+
+#include "../src/checksum.h"
+#include "../src/codec.h"
+#include "../src/stats.h"
+
+struct Corpus {
+  std::string name;
+  std::string data;
+};
+
+
+struct Options {
+  Options() : size(16 << 20), whole(false) {}
+
+  size_t size;
+  bool whole;
+  std::string codec;
+  std::string corpus;
+  std::vector<std::string> files;
+};
+
+
+// Deterministic generator, so results are comparable between runs.
+class Random {
+ public:
+  explicit Random(uint64_t seed) : state_(seed) {}
+
+  uint32_t Next() {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(state_ >> 33);
+  }
+
+  uint32_t Below(uint32_t n) {
+    return Next() % n;
+  }
+
+ private:
+  uint64_t state_;
+};
+
+
+static const char *Words[] = {
+  "the", "of", "and", "to", "in", "is", "that", "for", "it", "as", "was",
+  "with", "be", "by", "on", "not", "he", "this", "are", "or", "his", "from",
+  "at", "which", "but", "have", "an", "had", "they", "you", "were", "their",
+  "one", "all", "we", "can", "her", "has", "there", "been", "if", "more",
+  "when", "will", "would", "who", "so", "no", "stream", "buffer", "node",
+  "compression", "request", "worker", "thread", "callback", "output"
+};
+static const size_t WordCount = sizeof(Words) / sizeof(Words[0]);
+
+
+static void MakeText(std::string &out, size_t size, Random &rnd) {
+  while (out.size() < size) {
+    size_t words = 5 + rnd.Below(15);
+    for (size_t i = 0; i < words; ++i) {
+      out += Words[rnd.Below(WordCount)];
+      out += ' ';
+    }
+    out += ".\n";
+  }
+  out.resize(size);
+}
+
+
+static void MakeJson(std::string &out, size_t size, Random &rnd) {
+  char record[256];
+  out += "[";
+  for (uint32_t id = 0; out.size() < size; ++id) {
+    snprintf(record, sizeof(record),
+        "{\"id\":%u,\"name\":\"%s %s\",\"score\":%u.%02u,\"active\":%s,"
+        "\"tags\":[\"%s\",\"%s\"]},\n",
+        id, Words[rnd.Below(WordCount)], Words[rnd.Below(WordCount)],
+        rnd.Below(1000), rnd.Below(100), rnd.Below(2) ? "true" : "false",
+        Words[rnd.Below(WordCount)], Words[rnd.Below(WordCount)]);
+    out += record;
+  }
+  out.resize(size);
+}
+
+
+// Table of little-endian integers with small deltas, like columnar data.
+static void MakeBinary(std::string &out, size_t size, Random &rnd) {
+  uint32_t value = 0;
+  while (out.size() < size) {
+    value += rnd.Below(64);
+    uint32_t flags = rnd.Below(4);
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    out.append(reinterpret_cast<const char*>(&flags), sizeof(flags));
+  }
+  out.resize(size);
+}
+
+
+static void MakeRandom(std::string &out, size_t size, Random &rnd) {
+  out.reserve(size);
+  while (out.size() < size) {
+    uint32_t value = rnd.Next();
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  out.resize(size);
+}
+
+
+static bool ReadFile(const char *path, std::string &out) {
+  FILE *f = fopen(path, "rb");
+  if (f == 0) {
+    return false;
+  }
+  char chunk[65536];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    out.append(chunk, n);
+  }
+  fclose(f);
+  return true;
+}
+
+
+// Throughput is measured in uncompressed bytes in both directions.
+static void Report(const char *codec, const Corpus &corpus, int level,
+    size_t chunk, size_t bytesIn, size_t bytesOut, uint64_t ns, size_t calls) {
+  printf("{\"codec\":\"%s\",\"corpus\":\"%s\",\"level\":%d,\"chunk\":%lu,"
+      "\"bytesIn\":%lu,\"bytesOut\":%lu,\"ratio\":%.4f,\"seconds\":%.6f,"
+      "\"mbps\":%.2f,\"codecCalls\":%lu}\n",
+      codec, corpus.name.c_str(), level, (unsigned long)chunk,
+      (unsigned long)bytesIn, (unsigned long)bytesOut,
+      bytesIn ? (double)bytesOut / bytesIn : 0, ns / 1e9,
+      ns ? corpus.data.size() / (ns / 1e9) / (1 << 20) : 0,
+      (unsigned long)calls);
+  fflush(stdout);
+}
+
+
+// Push input through processor in chunks, appending output to result.
+template <class Processor>
+static bool Run(int level, const std::string &input, size_t chunk,
+    std::string &result, uint64_t &ns, size_t &calls) {
+  typedef typename Codec<Processor>::Utils Utils;
+  typedef typename Codec<Processor>::Blob Blob;
+
+  Codec<Processor> codec;
+  if (Utils::IsError(codec.Init(level))) {
+    return false;
+  }
+
+  result.clear();
+  calls = 0;
+  uint64_t start = NowNs();
+  for (size_t offset = 0; offset < input.size(); offset += chunk) {
+    size_t length = input.size() - offset < chunk ?
+        input.size() - offset : chunk;
+    Blob out;
+    int ret = codec.Write(const_cast<char*>(input.data()) + offset,
+        length, out, false);
+    if (Utils::IsError(ret)) {
+      return false;
+    }
+    result.append(reinterpret_cast<char*>(out.data()), out.length());
+  }
+  Blob out;
+  if (Utils::IsError(codec.Close(out))) {
+    return false;
+  }
+  result.append(reinterpret_cast<char*>(out.data()), out.length());
+  ns = NowNs() - start;
+  calls = codec.TakeCalls();
+  return true;
+}
+
+
+// Benchmark compressor and matching decompressor, verifying round trip.
+// Whole corpus goes in one write if whole is set.
+template <class Compressor, class Decompressor>
+static int Bench(const char *compressor, const char *decompressor,
+    const std::vector<Corpus> &corpora, const int *levels, size_t levelCount,
+    bool whole) {
+  static const size_t Fixed[] = { 1 << 10, 16 << 10, 256 << 10 };
+
+  int failures = 0;
+  std::string compressed, restored;
+  for (size_t c = 0; c < corpora.size(); ++c) {
+    const Corpus &corpus = corpora[c];
+    size_t Whole[] = { corpus.data.size() > 0 ? corpus.data.size() : 1 };
+    const size_t *Chunks = whole ? Whole : Fixed;
+    size_t ChunkCount = whole ? 1 : sizeof(Fixed) / sizeof(Fixed[0]);
+    for (size_t l = 0; l < levelCount; ++l) {
+      for (size_t k = 0; k < ChunkCount; ++k) {
+        uint64_t ns;
+        size_t calls;
+        if (!Run<Compressor>(levels[l], corpus.data, Chunks[k],
+              compressed, ns, calls)) {
+          fprintf(stderr, "%s failed on %s\n", compressor,
+              corpus.name.c_str());
+          ++failures;
+          continue;
+        }
+        Report(compressor, corpus, levels[l], Chunks[k],
+            corpus.data.size(), compressed.size(), ns, calls);
+
+        if (!Run<Decompressor>(-1, compressed, Chunks[k],
+              restored, ns, calls) || restored != corpus.data) {
+          fprintf(stderr, "%s round trip failed on %s\n", decompressor,
+              corpus.name.c_str());
+          ++failures;
+          continue;
+        }
+        Report(decompressor, corpus, levels[l], Chunks[k],
+            compressed.size(), restored.size(), ns, calls);
+      }
+    }
+  }
+  return failures;
+}
+
+
+#ifdef WITH_GZIP
+// Whole-buffer gzip, checking output against streaming Gunzip.
+static int BenchOneShot(const std::vector<Corpus> &corpora, const int *levels,
+    size_t levelCount) {
+  int failures = 0;
+  std::string restored;
+  for (size_t c = 0; c < corpora.size(); ++c) {
+    const Corpus &corpus = corpora[c];
+    for (size_t l = 0; l < levelCount; ++l) {
+      OneShot::Blob compressed;
+      uint64_t start = NowNs();
+      int ret = OneShot::Compress(OneShot::Gzip, levels[l],
+          corpus.data.data(), corpus.data.size(), compressed);
+      uint64_t ns = NowNs() - start;
+      if (GzipUtils::IsError(ret)) {
+        fprintf(stderr, "deflateBuffer failed on %s\n", corpus.name.c_str());
+        ++failures;
+        continue;
+      }
+      Report("deflateBuffer", corpus, levels[l], corpus.data.size(),
+          corpus.data.size(), compressed.length(), ns, 1);
+
+      OneShot::Blob inflated;
+      start = NowNs();
+      ret = OneShot::Decompress(OneShot::Auto,
+          reinterpret_cast<char*>(compressed.data()), compressed.length(),
+          inflated);
+      ns = NowNs() - start;
+      if (GzipUtils::IsError(ret) || inflated.length() != corpus.data.size() ||
+          memcmp(inflated.data(), corpus.data.data(), inflated.length())) {
+        fprintf(stderr, "inflateBuffer round trip failed on %s\n",
+            corpus.name.c_str());
+        ++failures;
+        continue;
+      }
+      Report("inflateBuffer", corpus, levels[l], compressed.length(),
+          compressed.length(), inflated.length(), ns, 1);
+
+      std::string input(reinterpret_cast<char*>(compressed.data()),
+          compressed.length());
+      size_t calls;
+      if (!Run<GunzipImpl>(-1, input, 16 << 10, restored, ns, calls) ||
+          restored != corpus.data) {
+        fprintf(stderr, "Gunzip of deflateBuffer output failed on %s\n",
+            corpus.name.c_str());
+        ++failures;
+      }
+    }
+  }
+  return failures;
+}
+#endif
+
+
+#ifdef WITH_ISAL
+enum DecodeResult {
+  Decoded,
+  Truncated,
+  Failed
+};
+
+
+// Gunzip input fed in random sized pieces, as network reads would be.
+static DecodeResult Decode(GunzipImpl::Engine engine, const std::string &input,
+    Random &rnd, std::string &result) {
+  GunzipImpl::SetEngine(engine);
+  Codec<GunzipImpl> codec;
+  result.clear();
+  if (GzipUtils::IsError(codec.Init(-1))) {
+    return Failed;
+  }
+  for (size_t offset = 0; offset < input.size(); ) {
+    size_t length = 1 + rnd.Below(1 << (1 + rnd.Below(17)));
+    if (length > input.size() - offset) {
+      length = input.size() - offset;
+    }
+    GzipUtils::Blob out;
+    int ret = codec.Write(const_cast<char*>(input.data()) + offset,
+        length, out, false);
+    result.append(reinterpret_cast<char*>(out.data()), out.length());
+    if (GzipUtils::IsError(ret)) {
+      return Failed;
+    }
+    if (ret == Z_STREAM_END) {
+      return Decoded;
+    }
+    offset += length;
+  }
+  return Truncated;
+}
+
+
+// Throughput of both inflate engines, then decoding of valid and mutated
+// streams, which must agree with zlib byte for byte.
+static int BenchInflateEngines(const std::vector<Corpus> &corpora,
+    const int *levels, size_t levelCount, size_t rounds) {
+  static const GunzipImpl::Engine Engines[] = {
+    GunzipImpl::ZlibEngine, GunzipImpl::IsalEngine
+  };
+  static const char *Names[] = { "Gunzip/zlib", "Gunzip/isal" };
+
+  int failures = 0;
+  std::string compressed, restored, expected, actual;
+  for (size_t c = 0; c < corpora.size(); ++c) {
+    const Corpus &corpus = corpora[c];
+    for (size_t l = 0; l < levelCount; ++l) {
+      uint64_t ns;
+      size_t calls;
+      if (!Run<GzipImpl>(levels[l], corpus.data, 64 << 10, compressed, ns,
+            calls)) {
+        ++failures;
+        continue;
+      }
+      for (size_t e = 0; e < 2; ++e) {
+        GunzipImpl::SetEngine(Engines[e]);
+        if (!Run<GunzipImpl>(-1, compressed, 64 << 10, restored, ns, calls) ||
+            restored != corpus.data) {
+          fprintf(stderr, "%s failed on %s\n", Names[e],
+              corpus.name.c_str());
+          ++failures;
+          continue;
+        }
+        Report(Names[e], corpus, levels[l], 64 << 10, compressed.size(),
+            restored.size(), ns, calls);
+      }
+
+      Random rnd(c * 131 + l);
+      size_t mismatches = 0;
+      for (size_t i = 0; i < rounds; ++i) {
+        std::string input = compressed;
+        switch (i % 4) {
+          case 1:
+            input[rnd.Below(input.size())] ^= (char)(1 << rnd.Below(8));
+            break;
+          case 2:
+            input.resize(rnd.Below(input.size()));
+            break;
+          case 3:
+            input[10 + rnd.Below(input.size() - 18)] = (char)rnd.Next();
+            break;
+        }
+        uint64_t seed = rnd.Next();
+        Random zlibRnd(seed), isalRnd(seed);
+        DecodeResult want = Decode(GunzipImpl::ZlibEngine, input, zlibRnd,
+            expected);
+        DecodeResult got = Decode(GunzipImpl::IsalEngine, input, isalRnd,
+            actual);
+        if (want != got || (want == Decoded && expected != actual)) {
+          ++mismatches;
+        }
+      }
+      if (mismatches) {
+        fprintf(stderr, "isal disagrees with zlib in %lu of %lu cases on %s\n",
+            (unsigned long)mismatches, (unsigned long)rounds,
+            corpus.name.c_str());
+        ++failures;
+      }
+    }
+  }
+  GunzipImpl::SetEngine(GunzipImpl::IsalEngine);
+  return failures;
+}
+#endif
+
+
+// Portable and SIMD checksum kernels, which must agree with zlib.
+static int BenchChecksums(const std::vector<Corpus> &corpora) {
+  struct Kernel {
+    const char *name;
+    Checksum::Kernel kernel;
+    bool crc;
+    // CPU may lack instructions compiler supports.
+    bool available;
+  };
+  const Kernel Kernels[] = {
+    { "crc32/slice8", Checksum::Crc32Slice8, true, true },
+#ifdef CHECKSUM_X86_SIMD
+    { "crc32/pclmul", Checksum::Crc32Pclmul, true,
+      strcmp(Checksum::Crc32Name(), "pclmul") == 0 },
+    { "adler32/ssse3", Checksum::Adler32Ssse3, false,
+      strcmp(Checksum::Adler32Name(), "ssse3") == 0 },
+#endif
+    { "adler32/scalar", Checksum::Adler32Scalar, false, true }
+  };
+
+  int failures = 0;
+  for (size_t c = 0; c < corpora.size(); ++c) {
+    const Corpus &corpus = corpora[c];
+    const unsigned char *data =
+        reinterpret_cast<const unsigned char*>(corpus.data.data());
+    size_t length = corpus.data.size();
+    uint32_t crc = Checksum::Crc32(0, corpus.data.data(), length);
+    uint32_t adler = Checksum::Adler32(1, corpus.data.data(), length);
+#ifdef WITH_GZIP
+    if (crc != crc32(0, data, length) || adler != adler32(1, data, length)) {
+      fprintf(stderr, "checksums differ from zlib on %s\n",
+          corpus.name.c_str());
+      ++failures;
+    }
+#endif
+    for (size_t k = 0; k < sizeof(Kernels) / sizeof(Kernels[0]); ++k) {
+      const Kernel &kernel = Kernels[k];
+      if (!kernel.available) {
+        continue;
+      }
+      // CRC kernels work on inverted register.
+      uint64_t start = NowNs();
+      uint32_t value = kernel.crc ? ~kernel.kernel(~0u, data, length) :
+          kernel.kernel(1, data, length);
+      uint64_t ns = NowNs() - start;
+      if (value != (kernel.crc ? crc : adler)) {
+        fprintf(stderr, "%s mismatch on %s\n", kernel.name,
+            corpus.name.c_str());
+        ++failures;
+      }
+      Report(kernel.name, corpus, 0, length, length, 4, ns, 1);
+    }
+  }
+  return failures;
+}
+
+
+static bool Selected(const std::string &filter, const char *name) {
+  return filter.empty() || strcasecmp(filter.c_str(), name) == 0;
+}
+
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      options.size = (size_t)atol(argv[++i]) << 20;
+    } else if (strcmp(argv[i], "--codec") == 0 && i + 1 < argc) {
+      options.codec = argv[++i];
+    } else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+      options.corpus = argv[++i];
+    } else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+      options.files.push_back(argv[++i]);
+    } else if (strcmp(argv[i], "--whole") == 0) {
+      options.whole = true;
+    } else {
+      fprintf(stderr, "usage: %s [--size MB] [--codec NAME] "
+          "[--corpus NAME] [--file PATH]... [--whole]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  typedef void (*Generator)(std::string&, size_t, Random&);
+  static const struct {
+    const char *name;
+    Generator generate;
+  } Generators[] = {
+    { "text", MakeText },
+    { "json", MakeJson },
+    { "binary", MakeBinary },
+    { "random", MakeRandom }
+  };
+
+  std::vector<Corpus> corpora;
+  for (size_t i = 0; i < sizeof(Generators) / sizeof(Generators[0]); ++i) {
+    if (!Selected(options.corpus, Generators[i].name)) {
+      continue;
+    }
+    Random rnd(i + 1);
+    corpora.push_back(Corpus());
+    corpora.back().name = Generators[i].name;
+    Generators[i].generate(corpora.back().data, options.size, rnd);
+  }
+  for (size_t i = 0; i < options.files.size(); ++i) {
+    corpora.push_back(Corpus());
+    corpora.back().name = options.files[i];
+    if (!ReadFile(options.files[i].c_str(), corpora.back().data)) {
+      fprintf(stderr, "Can't read %s\n", options.files[i].c_str());
+      return 2;
+    }
+  }
+
+  int failures = 0;
+#ifdef WITH_GZIP
+  if (Selected(options.codec, "gzip")) {
+    static const int Levels[] = { 1, 6, 9 };
+    failures += Bench<GzipImpl, GunzipImpl>("Gzip", "Gunzip", corpora,
+        Levels, sizeof(Levels) / sizeof(Levels[0]), options.whole);
+  }
+  if (Selected(options.codec, "oneshot")) {
+    static const int Levels[] = { 1, 6, 9 };
+    failures += BenchOneShot(corpora, Levels,
+        sizeof(Levels) / sizeof(Levels[0]));
+  }
+#endif
+#ifdef WITH_ISAL
+  if (Selected(options.codec, "inflate")) {
+    static const int Levels[] = { 1, 6, 9 };
+    failures += BenchInflateEngines(corpora, Levels,
+        sizeof(Levels) / sizeof(Levels[0]), 200);
+  }
+#endif
+#ifdef WITH_BZIP
+  if (Selected(options.codec, "bzip")) {
+    static const int Levels[] = { 1, 9 };
+    failures += Bench<BzipImpl, BunzipImpl>("Bzip", "Bunzip", corpora,
+        Levels, sizeof(Levels) / sizeof(Levels[0]), options.whole);
+  }
+#endif
+#ifdef WITH_LZ4
+  if (Selected(options.codec, "lz4")) {
+    static const int Levels[] = { 0, 9 };
+    failures += Bench<Lz4Impl, Unlz4Impl>("Lz4", "Unlz4", corpora,
+        Levels, sizeof(Levels) / sizeof(Levels[0]), options.whole);
+  }
+#endif
+#ifdef WITH_ZSTD
+  if (Selected(options.codec, "zstd")) {
+    static const int Levels[] = { 1, 3, 19 };
+    failures += Bench<ZstdImpl, UnzstdImpl>("Zstd", "Unzstd", corpora,
+        Levels, sizeof(Levels) / sizeof(Levels[0]), options.whole);
+  }
+#endif
+#ifdef WITH_XZ
+  if (Selected(options.codec, "xz")) {
+    static const int Levels[] = { 0, 6 };
+    failures += Bench<XzImpl, UnxzImpl>("Xz", "Unxz", corpora,
+        Levels, sizeof(Levels) / sizeof(Levels[0]), options.whole);
+  }
+#endif
+  if (Selected(options.codec, "checksum")) {
+    failures += BenchChecksums(corpora);
+  }
+  return failures ? 1 : 0;
+}
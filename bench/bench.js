@@ -0,0 +1,289 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// Throughput and per-write latency of callback and streams APIs.
+//   node bench/bench.js [sizeMB] [concurrency]
+// Emits one JSON object per measurement on stdout.
+
+var compress = require('../lib/compress');
+var Buffer = require('buffer').Buffer;
+var assert = require('assert');
+
+var SIZE = (parseInt(process.argv[2], 10) || 8) << 20;
+var CONCURRENCY = parseInt(process.argv[3], 10) || 8;
+var CHUNKS = [1 << 10, 16 << 10, 256 << 10];
+
+var WORDS = ('the of and to in is that for it as was with be by on not he ' +
+             'this are or his from at which but have an had they you were ' +
+             'stream buffer node compression request worker thread').split(' ');
+
+// Deterministic text corpus, so results are comparable between runs.
+function makeCorpus(size) {
+  var seed = 1;
+  function next(n) {
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+    return seed % n;
+  }
+  var parts = [], length = 0;
+  while (length < size) {
+    var word = WORDS[next(WORDS.length)] + (next(12) ? ' ' : '.\n');
+    parts.push(word);
+    length += word.length;
+  }
+  var buffer = new Buffer(size);
+  buffer.write(parts.join('').substring(0, size), 'binary', 0);
+  return buffer;
+}
+
+
+function percentile(sorted, p) {
+  if (sorted.length == 0) return 0;
+  var i = Math.min(sorted.length - 1, Math.floor(p / 100 * sorted.length));
+  return sorted[i];
+}
+
+
+function report(api, codec, chunk, bytes, ms, latencies) {
+  latencies.sort(function(a, b) { return a - b; });
+  console.log(JSON.stringify({
+    api: api,
+    codec: codec,
+    chunk: chunk,
+    concurrency: CONCURRENCY,
+    bytes: bytes,
+    seconds: ms / 1000,
+    mbps: bytes / (ms / 1000) / (1 << 20),
+    writeLatencyMs: {
+      p50: percentile(latencies, 50),
+      p90: percentile(latencies, 90),
+      p99: percentile(latencies, 99),
+      max: percentile(latencies, 100)
+    }
+  }));
+}
+
+
+// Splits input into CONCURRENCY shares, one per object.
+function split(input) {
+  var share = Math.floor(input.length / CONCURRENCY);
+  var shares = [];
+  for (var i = 0; i < CONCURRENCY; ++i) {
+    shares.push(input.slice(i * share, (i + 1) * share));
+  }
+  return shares;
+}
+
+
+function totalLength(buffers) {
+  var length = 0;
+  for (var i = 0; i < buffers.length; ++i) {
+    length += buffers[i].length;
+  }
+  return length;
+}
+
+
+// Each of CONCURRENCY objects writes its own input of shares sequentially,
+// next write is issued from the callback of the previous one.
+function benchCallbacks(name, create, shares, chunk, done) {
+  var latencies = [];
+  var pending = CONCURRENCY;
+  var start = Date.now();
+
+  function run(index) {
+    var impl = create();
+    var input = shares[index];
+    var offset = 0, end = input.length;
+    function step() {
+      if (offset >= end) {
+        impl.close(function(err) {
+          if (err) throw err;
+          if (--pending == 0) {
+            report('callback', name, chunk, totalLength(shares),
+                   Date.now() - start, latencies);
+            done();
+          }
+        });
+        return;
+      }
+      var piece = input.slice(offset, Math.min(offset + chunk, end));
+      offset += piece.length;
+      var issued = Date.now();
+      impl.write(piece, function(err) {
+        if (err) throw err;
+        latencies.push(Date.now() - issued);
+        step();
+      });
+    }
+    step();
+  }
+
+  for (var i = 0; i < CONCURRENCY; ++i) {
+    run(i);
+  }
+}
+
+
+// Streams are written without waiting, measuring time until 'end'.
+function benchStreams(name, create, shares, chunk, done) {
+  var pending = CONCURRENCY;
+  var start = Date.now();
+
+  for (var i = 0; i < CONCURRENCY; ++i) {
+    var stream = create();
+    stream.on('error', function(err) { throw err; });
+    stream.on('data', function() {});
+    stream.on('end', function() {
+      if (--pending == 0) {
+        report('stream', name, chunk, totalLength(shares),
+               Date.now() - start, []);
+        done();
+      }
+    });
+    var input = shares[i];
+    for (var offset = 0; offset < input.length; offset += chunk) {
+      stream.write(input.slice(offset, Math.min(offset + chunk, input.length)));
+    }
+    stream.end();
+  }
+}
+
+
+// Compress input once for decompression benchmarks.
+function compressAll(create, input, callback) {
+  var impl = create();
+  impl.write(input, function(err, head) {
+    if (err) throw err;
+    impl.close(function(err, tail) {
+      if (err) throw err;
+      var result = new Buffer(head.length + tail.length);
+      head.copy(result, 0);
+      tail.copy(result, head.length);
+      callback(result);
+    });
+  });
+}
+
+
+// Compresses every share into a complete stream of its own.
+function compressShares(create, shares, callback) {
+  var compressed = [];
+  (function next() {
+    if (compressed.length == shares.length) return callback(compressed);
+    compressAll(create, shares[compressed.length], function(result) {
+      compressed.push(result);
+      next();
+    });
+  })();
+}
+
+
+var input = makeCorpus(SIZE);
+var shares = split(input);
+var cases = [];
+
+function addCases(compressName, compressor, stream, decompressName,
+                  decompressor, decompressStream) {
+  CHUNKS.forEach(function(chunk) {
+    cases.push(function(next) {
+      benchCallbacks(compressName, compressor, shares, chunk, next);
+    });
+    cases.push(function(next) {
+      benchStreams(compressName + 'Stream', stream, shares, chunk, next);
+    });
+  });
+  cases.push(function(next) {
+    compressShares(compressor, shares, function(compressed) {
+      var queue = [];
+      CHUNKS.forEach(function(chunk) {
+        queue.push(function(then) {
+          benchCallbacks(decompressName, decompressor, compressed, chunk, then);
+        });
+        queue.push(function(then) {
+          benchStreams(decompressName + 'Stream', decompressStream,
+                       compressed, chunk, then);
+        });
+      });
+      (function drain() {
+        if (queue.length == 0) return next();
+        queue.shift()(drain);
+      })();
+    });
+  });
+}
+
+if (compress.gzipSupport) {
+  addCases('Gzip', function() { return new compress.Gzip(6, true); },
+           function() { return new compress.GzipStream(6, true); },
+           'Gunzip', function() { return new compress.Gunzip(true); },
+           function() { return new compress.GunzipStream(true); });
+}
+if (compress.gzipSupport) {
+  cases.push(function(next) {
+    var start = Date.now();
+    compress.deflateBuffer(input, 'gzip', 6, function(err, compressed) {
+      if (err) throw err;
+      report('oneshot', 'deflateBuffer', input.length, input.length,
+             Date.now() - start, []);
+      start = Date.now();
+      compress.inflateBuffer(compressed, function(err, restored) {
+        if (err) throw err;
+        assert.equal(restored.length, input.length);
+        report('oneshot', 'inflateBuffer', compressed.length,
+               compressed.length, Date.now() - start, []);
+        next();
+      });
+    });
+  });
+}
+if (compress.bzipSupport) {
+  addCases('Bzip', function() { return new compress.Bzip(9, 0, true, true); },
+           function() { return new compress.BzipStream(9, 0, true, true); },
+           'Bunzip', function() { return new compress.Bunzip(false, true); },
+           function() { return new compress.BunzipStream(false, true); });
+}
+if (compress.lz4Support) {
+  addCases('Lz4', function() { return new compress.Lz4(0, true); },
+           function() { return new compress.Lz4Stream(0, true); },
+           'Unlz4', function() { return new compress.Unlz4(true); },
+           function() { return new compress.Unlz4Stream(true); });
+}
+if (compress.zstdSupport) {
+  addCases('Zstd', function() { return new compress.Zstd(3, true); },
+           function() { return new compress.ZstdStream(3, true); },
+           'Unzstd', function() { return new compress.Unzstd(true); },
+           function() { return new compress.UnzstdStream(true); });
+}
+if (compress.xzSupport) {
+  addCases('Xz', function() { return new compress.Xz(6, true); },
+           function() { return new compress.XzStream(6, true); },
+           'Unxz', function() { return new compress.Unxz(true); },
+           function() { return new compress.UnxzStream(true); });
+}
+
+(function next() {
+  if (cases.length == 0) {
+    console.log(JSON.stringify({ stats: compress.getStats() }));
+    return;
+  }
+  cases.shift()(next);
+})();
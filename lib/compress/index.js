@@ -39,6 +39,13 @@ function fallbackConstructor(str) {
 }
 
 
+function fallbackFunction(str) {
+  return function() {
+    throw new Error(str);
+  }
+}
+
+
 function inherits(ctor, superCtor) {
   ctor.prototype = Object.create(superCtor.prototype, {
       constructor: {
@@ -76,6 +83,49 @@ Bunzip.prototype.init = removed('Use constructor to create new bunzip object.');
 Bunzip.prototype.inflate = removed('Use write() instead.');
 Bunzip.prototype.end = removed('Use close() instead.')
 
+var Lz4 = bindings.Lz4 ||
+          fallbackConstructor('Library built without lz4 support.');
+
+
+var Unlz4 = bindings.Unlz4 ||
+            fallbackConstructor('Library built without lz4 support.');
+
+
+var Zstd = bindings.Zstd ||
+           fallbackConstructor('Library built without zstd support.');
+
+
+var Unzstd = bindings.Unzstd ||
+             fallbackConstructor('Library built without zstd support.');
+
+
+var ZstdDictionary = bindings.ZstdDictionary ||
+                     fallbackConstructor('Library built without zstd support.');
+
+
+var Xz = bindings.Xz ||
+         fallbackConstructor('Library built without xz support.');
+
+
+var Unxz = bindings.Unxz ||
+           fallbackConstructor('Library built without xz support.');
+
+var Transcode = bindings.Transcode;
+
+var deflateBuffer = bindings.deflateBuffer ||
+                    fallbackFunction('Library built without gzip support.');
+var inflateBuffer = bindings.inflateBuffer ||
+                    fallbackFunction('Library built without gzip support.');
+var compressTiered = bindings.compressTiered ||
+                     fallbackFunction('Library built without gzip support.');
+var joinGzip = bindings.joinGzip ||
+               fallbackFunction('Library built without gzip support.');
+var compressBatch = bindings.compressBatch ||
+                    fallbackFunction('Library built without gzip support.');
+
+var setInflateEngine = bindings.setInflateEngine ||
+                       fallbackFunction('Library built without gzip support.');
+
 var apiWarnings = true;
 function setApiWarnings(value) {
   apiWarnings = value;
@@ -110,10 +160,16 @@ function CommonStream(ctor, args) {
 inherits(CommonStream, events.EventEmitter);
 CommonStream.prototype.paused_ = false;
 CommonStream.prototype.inputEncoding_ = null;
+// Whether impl_.write() takes strings in these encodings itself.
+CommonStream.prototype.nativeStrings_ = {utf8: true, 'utf-8': true,
+                                         ascii: true, binary: true};
+// Whether impl_.write() takes arrays of Buffers.
+CommonStream.prototype.nativeGather_ = true;
 CommonStream.prototype.outputEncoding_ = null;
 CommonStream.prototype.readable = true;
 CommonStream.prototype.writable = true;
 CommonStream.prototype.endFromDestroy = false;
+CommonStream.prototype.destroyed_ = false;
 
 
 CommonStream.prototype.pause = function() {
@@ -129,19 +185,31 @@ CommonStream.prototype.resume = function() {
 };
 
 
+// Drops pending input and output at once, queued requests are cancelled.
 CommonStream.prototype.destroy = function(err) {
+  if (this.destroyed_) {
+    return;
+  }
+  this.destroyed_ = true;
   this.readable = false;
   this.writable = false;
+  this.dataQueue_.length = 0;
+  this.impl_.destroy();
   if (err) {
-    this.impl_.destroy();
     process.nextTick(this.emit.bind(this,'error',err));
   } else {
-    this.endFromDestroy = true;
-    this.end();
+    process.nextTick(this.emit.bind(this,'close'));
   }
 };
 
 
+// Flushes pending input, emits remaining 'data' and then 'close'.
+CommonStream.prototype.destroySoon = function() {
+  this.endFromDestroy = true;
+  this.end();
+};
+
+
 CommonStream.prototype.write = function(data, opt_encoding) {
   if (!this.writable) {
     return true;
@@ -150,11 +218,34 @@ CommonStream.prototype.write = function(data, opt_encoding) {
   var self = this;
   var buffer = null;
 
+  if (Array.isArray(data)) {
+    if (this.nativeGather_) {
+      // Written in one request, into one output.
+      this.impl_.write(data, function(err, data) {
+        self.emitEvent_(err, data);
+      });
+    } else {
+      for (var i = 0; i < data.length; ++i) {
+        this.write(data[i], opt_encoding);
+      }
+    }
+    return true;
+  }
+
   var encoding = null;
   if (!Buffer.isBuffer(data)) {
     encoding = opt_encoding || this.inputEncoding_ || 'utf8';
   }
 
+  if (encoding !== null && this.nativeStrings_ &&
+      this.nativeStrings_[encoding] === true) {
+    // Encoded by native side, without intermediate Buffer.
+    this.impl_.write(String(data), encoding, function(err, data) {
+      self.emitEvent_(err, data);
+    });
+    return true;
+  }
+
   if (encoding !== null) {
     // Not buffer input.
     var len = Buffer.byteLength(data, encoding);
@@ -194,6 +285,16 @@ CommonStream.prototype.close = function() {
 };
 
 
+CommonStream.prototype.stats = function() {
+  return this.impl_.stats();
+};
+
+
+CommonStream.prototype.setIdleTimeout = function(ms) {
+  this.impl_.setIdleTimeout(ms);
+};
+
+
 CommonStream.prototype.setInputEncoding = function(enc) {
   apiWarning('setInputEncoding() breaks standard streams API.\n' +
       '  The method is an extension to standard API and might be removed in ' +
@@ -223,6 +324,10 @@ CommonStream.prototype.emitData_ = function() {
 };
 
 CommonStream.prototype.emitEvent_ = function(err, data, fin) {
+  if (this.destroyed_) {
+    // Cancelled or late results of destroyed stream.
+    return;
+  }
   if (err) {
     this.readable = false;
     this.writable = false;
@@ -309,18 +414,165 @@ function BunzipStream() {
 inherits(BunzipStream, DecompressStream);
 
 
+// === Lz4Stream ===
+function Lz4Stream() {
+  CompressStream.call(this, Lz4, arguments);
+}
+inherits(Lz4Stream, CompressStream);
+
+
+// === Unlz4Stream ===
+function Unlz4Stream() {
+  DecompressStream.call(this, Unlz4, arguments);
+}
+inherits(Unlz4Stream, DecompressStream);
+
+
+// === ZstdStream ===
+function ZstdStream() {
+  CompressStream.call(this, Zstd, arguments);
+}
+inherits(ZstdStream, CompressStream);
+
+
+// === UnzstdStream ===
+function UnzstdStream() {
+  DecompressStream.call(this, Unzstd, arguments);
+}
+inherits(UnzstdStream, DecompressStream);
+
+
+// === XzStream ===
+function XzStream() {
+  CompressStream.call(this, Xz, arguments);
+}
+inherits(XzStream, CompressStream);
+
+
+// === UnxzStream ===
+function UnxzStream() {
+  DecompressStream.call(this, Unxz, arguments);
+}
+inherits(UnxzStream, DecompressStream);
+
+
+// === TranscodeStream ===
+function TranscodeStream() {
+  CompressStream.call(this, Transcode, arguments);
+}
+inherits(TranscodeStream, CompressStream);
+
+
+// === FanoutStream ===
+// Compresses input by several codecs, see Fanout.  Emits 'data' with
+// (buffer, tag) for every non-empty output.
+function FanoutStream(outputs) {
+  CompressStream.call(this, bindings.Fanout, arguments);
+}
+inherits(FanoutStream, CompressStream);
+FanoutStream.prototype.nativeStrings_ = null;
+FanoutStream.prototype.nativeGather_ = false;
+
+
+FanoutStream.prototype.emitData_ = function() {
+  if (!this.paused_) {
+    for (var i = 0; i < this.dataQueue_.length; ++i) {
+      var item = this.dataQueue_[i];
+      if (item !== null) {
+        this.emit('data', item.data, item.tag);
+      } else {
+        this.readable = false;
+        var end = 'end';
+        if (this.endFromDestroy) {
+          this.impl_.destroy();
+          end = 'close';
+        }
+        process.nextTick(this.emit.bind(this,end));
+      }
+    }
+    this.dataQueue_.length = 0;
+  }
+};
+
+
+FanoutStream.prototype.emitEvent_ = function(err, outputs, fin) {
+  if (this.destroyed_) {
+    return;
+  }
+  if (err) {
+    this.readable = false;
+    this.writable = false;
+    this.emit('error', err);
+    return;
+  }
+
+  for (var tag in outputs) {
+    if (outputs[tag].length != 0) {
+      this.dataQueue_.push({ tag: tag, data: outputs[tag] });
+    }
+  }
+
+  if (fin) {
+    this.dataQueue_.push(null);
+  }
+  this.emitData_();
+};
+
+
 exports.Gzip = Gzip;
 exports.Gunzip = Gunzip;
 exports.Bzip = Bzip;
 exports.Bunzip = Bunzip;
+exports.Lz4 = Lz4;
+exports.Unlz4 = Unlz4;
+exports.Zstd = Zstd;
+exports.Unzstd = Unzstd;
+exports.ZstdDictionary = ZstdDictionary;
+exports.Xz = Xz;
+exports.Unxz = Unxz;
+exports.Transcode = Transcode;
+exports.Fanout = bindings.Fanout;
+exports.MessageDeflate = bindings.MessageDeflate ||
+    fallbackConstructor('Library built without gzip support.');
+exports.MessageInflate = bindings.MessageInflate ||
+    fallbackConstructor('Library built without gzip support.');
 
 exports.GzipStream = GzipStream;
 exports.GunzipStream = GunzipStream;
 exports.BzipStream = BzipStream;
 exports.BunzipStream = BunzipStream;
+exports.Lz4Stream = Lz4Stream;
+exports.Unlz4Stream = Unlz4Stream;
+exports.ZstdStream = ZstdStream;
+exports.UnzstdStream = UnzstdStream;
+exports.XzStream = XzStream;
+exports.UnxzStream = UnxzStream;
+exports.TranscodeStream = TranscodeStream;
+exports.FanoutStream = FanoutStream;
+
+exports.deflateBuffer = deflateBuffer;
+exports.inflateBuffer = inflateBuffer;
+exports.compressTiered = compressTiered;
+exports.joinGzip = joinGzip;
+exports.compressBatch = compressBatch;
+exports.setInflateEngine = setInflateEngine;
+exports.crc32 = bindings.crc32;
+exports.adler32 = bindings.adler32;
+exports.crc32Combine = bindings.crc32Combine;
+exports.adler32Combine = bindings.adler32Combine;
+exports.compressFile = bindings.compressFile;
+exports.decompressFile = bindings.decompressFile;
 
 exports.setApiWarnings = setApiWarnings;
+exports.getStats = bindings.getStats;
+exports.setTracing = bindings.setTracing;
+exports.getTrace = bindings.getTrace;
+exports.setOutputCache = bindings.setOutputCache;
+exports.getOutputCacheStats = bindings.getOutputCacheStats;
 exports.hasGzipHeader = hasGzipHeader;
 
 exports.gzipSupport = bindings.Gzip ? true : false;
 exports.bzipSupport = bindings.Bzip ? true : false;
+exports.lz4Support = bindings.Lz4 ? true : false;
+exports.zstdSupport = bindings.Zstd ? true : false;
+exports.xzSupport = bindings.Xz ? true : false;
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NODE_COMPRESS_ANYCODEC_H__
+#define NODE_COMPRESS_ANYCODEC_H__
+
+#include <node.h>
+#include <stddef.h>
+
+#include "codec.h"
+
+// Codec with processor chosen at run time, for native code that works with
+// any library (see registry.h).  Output accumulates in an owned buffer until
+// Clear().  Statuses are the processor's own, classify them with IsError()
+// and IsEnd().
+class AnyCodec {
+ public:
+  virtual ~AnyCodec() {}
+
+  virtual int Init(int level) = 0;
+  virtual int Write(char *data, size_t dataLength) = 0;
+  virtual int Close() = 0;
+
+  // Write() returning once output holds limit bytes or more, with
+  // dataLength left at the input not consumed yet.
+  virtual int WriteSome(char *data, size_t &dataLength, size_t limit) = 0;
+
+  // Write() and Close() appending output to out instead of own buffer.
+  virtual int Write(char *data, size_t dataLength, ScopedBlob &out) = 0;
+  virtual int Close(ScopedBlob &out) = 0;
+
+  virtual bool IsError(int status) const = 0;
+  virtual bool IsEnd(int status) const = 0;
+  virtual v8::Local<v8::Value> GetException(int status) const = 0;
+
+  virtual const char *data() const = 0;
+  virtual size_t length() const = 0;
+  virtual void Clear() = 0;
+  virtual char *Release() = 0;
+};
+
+
+template <class Processor>
+class AnyCodecImpl : public AnyCodec {
+ public:
+  typedef typename Codec<Processor>::Utils Utils;
+  typedef typename Codec<Processor>::Blob Blob;
+
+ public:
+  AnyCodecImpl() {}
+
+
+  int Init(int level) {
+    return codec_.Init(level);
+  }
+
+
+  int Write(char *data, size_t dataLength) {
+    return codec_.Write(data, dataLength, out_, false);
+  }
+
+
+  int Close() {
+    return codec_.Close(out_);
+  }
+
+
+  int WriteSome(char *data, size_t &dataLength, size_t limit) {
+    return codec_.WriteSome(data, dataLength, out_, limit);
+  }
+
+
+  // Own buffer is swapped with out for the call.
+  int Write(char *data, size_t dataLength, ScopedBlob &out) {
+    out_.Swap(out);
+    int ret = codec_.Write(data, dataLength, out_, false);
+    out_.Swap(out);
+    return ret;
+  }
+
+
+  int Close(ScopedBlob &out) {
+    out_.Swap(out);
+    int ret = codec_.Close(out_);
+    out_.Swap(out);
+    return ret;
+  }
+
+
+  bool IsError(int status) const {
+    return Utils::IsError(status);
+  }
+
+
+  bool IsEnd(int status) const {
+    return status == Utils::StatusEndOfStream();
+  }
+
+
+  v8::Local<v8::Value> GetException(int status) const {
+    return Utils::GetException(status);
+  }
+
+
+  const char *data() const {
+    return reinterpret_cast<const char*>(out_.data());
+  }
+
+
+  size_t length() const {
+    return out_.length();
+  }
+
+
+  // Buffer is kept for the following writes.
+  void Clear() {
+    out_.ResetLength();
+  }
+
+
+  // Passes output to the caller, who must free() it.
+  char *Release() {
+    return reinterpret_cast<char*>(out_.Release());
+  }
+
+ private:
+  Codec<Processor> codec_;
+  Blob out_;
+
+ private:
+  AnyCodecImpl(AnyCodecImpl&);
+  AnyCodecImpl(const AnyCodecImpl&);
+  AnyCodecImpl& operator=(AnyCodecImpl&);
+  AnyCodecImpl& operator=(const AnyCodecImpl&);
+};
+
+#endif
@@ -0,0 +1,357 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <node.h>
+#include <node_buffer.h>
+#include <zlib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "utils.h"
+#include "buffer.h"
+#include "oneshot.h"
+#include "stats.h"
+
+using namespace v8;
+using namespace node;
+
+// compressBatch(buffers, [options], callback): compresses every Buffer of
+// the array independently, as deflateBuffer() would, with a single
+// callback.  options are format ('gzip', 'zlib' or 'raw', [gzip]) and
+// level.  Items are split into contiguous runs of similar total size, one
+// thread pool job per run, each reusing its thread's deflate context.
+// Callback receives error and {data, offsets}: output of all items in one
+// Buffer, item i at [offsets[i], offsets[i + 1]).
+class BatchCodec {
+ private:
+  enum {
+    MaxJobs = 4,
+    MinJobBytes = 64 << 10,
+    MaxItem = 1 << 30
+  };
+
+  struct Item {
+    const char *data;
+    size_t length;
+
+    // Output of the item ends here in its job's output, starts where
+    // previous item of the job ends.
+    size_t end;
+  };
+
+  struct Batch;
+
+  struct Job {
+    Job()
+      : batch(0), first(0), last(0), status(Z_OK)
+    {}
+
+    Batch *batch;
+    int first;
+    int last;
+    int status;
+    OneShot::Blob out;
+  };
+
+  struct Batch {
+    Batch(Local<Value> input, Local<Function> callback,
+        OneShot::Format format, int level)
+      : format(format), level(level), items(0), count(0), jobs(0),
+        pending(0), queued_at(NowNs())
+    {
+      this->input = Persistent<Value>::New(input);
+      this->callback = Persistent<Function>::New(callback);
+    }
+
+    ~Batch() {
+      input.Dispose();
+      callback.Dispose();
+      delete[] items;
+    }
+
+    Persistent<Value> input;
+    Persistent<Function> callback;
+    OneShot::Format format;
+    int level;
+
+    Item *items;
+    int count;
+
+    Job job[MaxJobs];
+    int jobs;
+    int pending;
+    uint64_t queued_at;
+  };
+
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+
+    NODE_SET_METHOD(target, "compressBatch", Compress);
+    StatsRegistry::Register("compressBatch", &stats_);
+  }
+
+ private:
+  static Handle<Value> Compress(const Arguments &args) {
+    HandleScope scope;
+
+    if (args.Length() < 2 || !args[0]->IsArray()) {
+      return ThrowException(Exception::TypeError(
+            String::New("Input must be an array of Buffers")));
+    }
+    if (!args[args.Length() - 1]->IsFunction()) {
+      return ThrowException(Exception::TypeError(
+            String::New("Callback must be a function")));
+    }
+
+    OneShot::Format format = OneShot::Gzip;
+    int level = -1;
+    if (args.Length() > 2 && !args[1]->IsUndefined()) {
+      if (!args[1]->IsObject()) {
+        return ThrowException(Exception::TypeError(
+              String::New("Options must be an object")));
+      }
+      Local<Object> options = args[1]->ToObject();
+      Local<Value> value = options->Get(String::NewSymbol("format"));
+      if (!value->IsUndefined()) {
+        String::AsciiValue name(value);
+        if (*name == 0 || !ParseFormat(*name, format)) {
+          return ThrowException(Exception::TypeError(
+                String::New("format must be one of 'gzip', 'zlib', 'raw'")));
+        }
+      }
+      value = options->Get(String::NewSymbol("level"));
+      if (!value->IsUndefined()) {
+        if (!value->IsInt32() || value->Int32Value() < -1 ||
+            value->Int32Value() > OneShot::MaxLevel) {
+          return ThrowException(Exception::TypeError(
+                String::New("level is out of range")));
+        }
+        level = value->Int32Value();
+      }
+    }
+
+    // Copy, so that caller may reuse the array.
+    Local<Array> buffers = Local<Array>::Cast(args[0]);
+    Local<Array> input = Array::New(buffers->Length());
+    for (uint32_t i = 0; i < buffers->Length(); ++i) {
+      Local<Value> buffer = buffers->Get(i);
+      if (!Buffer::HasInstance(buffer)) {
+        return ThrowException(Exception::TypeError(
+              String::New("Input must be an array of Buffers")));
+      }
+      input->Set(i, buffer);
+    }
+
+    Batch *batch = new(std::nothrow) Batch(input,
+        Local<Function>::Cast(args[args.Length() - 1]), format, level);
+    if (batch != 0 && input->Length() > 0) {
+      batch->items = new(std::nothrow) Item[input->Length()];
+      if (batch->items == 0) {
+        delete batch;
+        batch = 0;
+      }
+    }
+    if (batch == 0) {
+      V8::LowMemoryNotification();
+      return ThrowException(Exception::Error(
+            String::New("Insufficient space")));
+    }
+
+    size_t total = 0;
+    batch->count = input->Length();
+    for (int i = 0; i < batch->count; ++i) {
+      Local<Object> buffer = input->Get(i)->ToObject();
+      batch->items[i].data = Buffer::Data(buffer);
+      batch->items[i].length = Buffer::Length(buffer);
+      total += batch->items[i].length;
+    }
+    Split(batch, total);
+
+    for (int i = 0; i < batch->jobs; ++i) {
+      eio_custom(DoJob, EIO_PRI_DEFAULT, DoHandleJob, &batch->job[i]);
+      ev_ref(EV_DEFAULT_UC);
+    }
+    return Undefined();
+  }
+
+
+  static bool ParseFormat(const char *name, OneShot::Format &format) {
+    if (strcmp(name, "gzip") == 0) {
+      format = OneShot::Gzip;
+    } else if (strcmp(name, "zlib") == 0) {
+      format = OneShot::Zlib;
+    } else if (strcmp(name, "raw") == 0) {
+      format = OneShot::Raw;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+
+  // Cuts items into runs of about equal input size, at least MinJobBytes
+  // each.  Empty batch still gets one job to report back.
+  static void Split(Batch *batch, size_t total) {
+    int jobs = total / MinJobBytes;
+    jobs = jobs < 1 ? 1 : jobs > MaxJobs ? MaxJobs : jobs;
+    jobs = jobs > batch->count && batch->count > 0 ? batch->count : jobs;
+
+    size_t share = total / jobs;
+    size_t taken = 0;
+    int first = 0;
+    batch->jobs = 0;
+    for (int i = 0; i < batch->count; ++i) {
+      taken += batch->items[i].length;
+      bool cut = taken >= share * (batch->jobs + 1) &&
+          batch->jobs < jobs - 1;
+      if (cut || i == batch->count - 1) {
+        AddJob(batch, first, i + 1);
+        first = i + 1;
+      }
+    }
+    if (batch->jobs == 0) {
+      AddJob(batch, 0, 0);
+    }
+    batch->pending = batch->jobs;
+  }
+
+
+  static void AddJob(Batch *batch, int first, int last) {
+    Job &job = batch->job[batch->jobs++];
+    job.batch = batch;
+    job.first = first;
+    job.last = last;
+  }
+
+
+  // Executed in worker thread.
+  static int DoJob(eio_req *req) {
+    Job *job = reinterpret_cast<Job*>(req->data);
+    Batch *batch = job->batch;
+
+    uint64_t start = NowNs();
+    CodecStats::Add(stats_.queue_wait_ns, start - batch->queued_at);
+
+    size_t bytes = 0;
+    for (int i = job->first; i < job->last; ++i) {
+      Item &item = batch->items[i];
+      int ret = item.length > MaxItem ? Z_MEM_ERROR :
+          OneShot::Compress(batch->format, batch->level, item.data,
+              item.length, job->out);
+      CodecStats::Add(stats_.codec_calls, 1);
+      if (GzipUtils::IsError(ret)) {
+        job->status = ret;
+        stats_.AddError(ret);
+        break;
+      }
+      item.end = job->out.length();
+      bytes += item.length;
+    }
+
+    CodecStats::Add(stats_.bytes_in, bytes);
+    CodecStats::Add(stats_.bytes_out, job->out.length());
+    CodecStats::Add(stats_.reallocs, job->out.reallocs());
+    CodecStats::Add(stats_.write_ns, NowNs() - start);
+    return 0;
+  }
+
+
+  // Calls back when the last job of the batch is done.
+  // Executed in V8 thread.
+  static int DoHandleJob(eio_req *req) {
+    Job *job = reinterpret_cast<Job*>(req->data);
+    Batch *batch = job->batch;
+
+    if (--batch->pending == 0) {
+      DoCallback(batch);
+      delete batch;
+    }
+
+    ev_unref(EV_DEFAULT_UC);
+    return 0;
+  }
+
+
+  static void DoCallback(Batch *batch) {
+    HandleScope scope;
+
+    CodecStats::Add(stats_.requests, 1);
+    Local<Value> argv[2];
+    argv[0] = Local<Value>::New(Undefined());
+    argv[1] = Local<Value>::New(Undefined());
+
+    size_t length = 0;
+    for (int i = 0; i < batch->jobs; ++i) {
+      Job &job = batch->job[i];
+      if (GzipUtils::IsError(job.status) && argv[0]->IsUndefined()) {
+        argv[0] = GzipUtils::GetException(job.status);
+      }
+      length += job.out.length();
+    }
+
+    if (argv[0]->IsUndefined()) {
+      argv[1] = Collect(batch, length);
+    }
+
+    TryCatch try_catch;
+    batch->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+    if (try_catch.HasCaught()) {
+      FatalException(try_catch);
+    }
+  }
+
+
+  // Copies job outputs into one Buffer and builds the offsets table.
+  static Local<Value> Collect(Batch *batch, size_t length) {
+    HandleScope scope;
+
+    Buffer *slowBuffer = Buffer::New(length);
+    char *data = Buffer::Data(slowBuffer);
+    Local<Array> offsets = Array::New(batch->count + 1);
+
+    size_t offset = 0;
+    offsets->Set(0, Number::New(0));
+    for (int i = 0; i < batch->jobs; ++i) {
+      Job &job = batch->job[i];
+      if (job.out.length() > 0) {
+        memcpy(data + offset, job.out.data(), job.out.length());
+      }
+      for (int k = job.first; k < job.last; ++k) {
+        offsets->Set(k + 1, Number::New(offset + batch->items[k].end));
+      }
+      offset += job.out.length();
+      job.out.Free();
+    }
+
+    Local<Object> result = Object::New();
+    result->Set(String::NewSymbol("data"), MakeBuffer(slowBuffer, 0, length));
+    result->Set(String::NewSymbol("offsets"), offsets);
+    return scope.Close(result);
+  }
+
+ private:
+  static CodecStats stats_;
+};
+CodecStats BatchCodec::stats_;
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NODE_COMPRESS_BUFFER_H__
+#define NODE_COMPRESS_BUFFER_H__
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <node.h>
+#include <node_buffer.h>
+
+// Helpers handing output to JS as Buffers, for the V8 side of the addon.
+// Headers shared with native tools don't include it.
+
+// Buffer free callback for memory obtained with malloc().
+static inline void FreeMalloced(char *data, void *hint) {
+  free(data);
+}
+
+
+// JS Buffer constructor, looked up on first use.
+// Executed in V8 thread.
+static inline v8::Local<v8::Function> BufferConstructor() {
+  static v8::Persistent<v8::Function> constructor;
+  if (constructor.IsEmpty()) {
+    v8::Local<v8::Object> global = v8::Context::GetCurrent()->Global();
+    constructor = v8::Persistent<v8::Function>::New(
+        v8::Local<v8::Function>::Cast(global->Get(v8::String::New("Buffer"))));
+  }
+  return v8::Local<v8::Function>::New(constructor);
+}
+
+
+// JS Buffer of length bytes at start of slowBuffer, sharing its memory.
+// Executed in V8 thread.
+static inline v8::Local<v8::Value> MakeBuffer(node::Buffer *slowBuffer,
+    size_t start, size_t length) {
+  v8::Handle<v8::Value> constructorArgs[3];
+  constructorArgs[0] = slowBuffer->handle_;
+  constructorArgs[1] = v8::Number::New(static_cast<double>(length));
+  constructorArgs[2] = v8::Number::New(static_cast<double>(start));
+  return BufferConstructor()->NewInstance(3, constructorArgs);
+}
+
+
+// JS Buffer taking over data without copying, callback(data, hint)
+// releases it.  Null data gives an empty Buffer and is released at once.
+// Executed in V8 thread.
+static inline v8::Local<v8::Value> MakeBuffer(char *data, size_t length,
+    node::Buffer::free_callback callback, void *hint) {
+  if (data == 0) {
+    callback(data, hint);
+    return MakeBuffer(node::Buffer::New(0), 0, 0);
+  }
+  return MakeBuffer(node::Buffer::New(data, length, callback, hint), 0,
+      length);
+}
+
+
+static inline v8::Handle<v8::Value> ThrowGentleOom() {
+  v8::V8::LowMemoryNotification();
+  v8::Local<v8::Value> exception = v8::Exception::Error(
+      v8::String::New("Insufficient space"));
+  return v8::ThrowException(exception);
+}
+
+#endif
@@ -127,6 +127,7 @@ class BzipImpl {
  public:
 #endif
   friend class ZipLib<BzipImpl>;
+  friend class Codec<BzipImpl>;
 
   typedef BzipUtils Utils;
   typedef BzipUtils::Blob Blob;
@@ -163,28 +164,42 @@ class BzipImpl {
       want_buffer_ = args[2]->BooleanValue() ? true : false;
     }
 
+    int ret = InitStream(blockSize100k, workFactor);
+    if (Utils::IsError(ret)) {
+      return ThrowException(Utils::GetException(ret));
+    }
+    return Undefined();
+  }
+
+
+  int Init(int level) {
+    want_buffer_ = true;
+    return InitStream(level < 0 ? 9 : level, 0);
+  }
+
+
+  int InitStream(int blockSize100k, int workFactor) {
     /* allocate deflate state */
     stream_.bzalloc = NULL;
     stream_.bzfree = NULL;
     stream_.opaque = NULL;
 
-    int ret = BZ2_bzCompressInit(&stream_, blockSize100k, 0, workFactor);
-    if (Utils::IsError(ret)) {
-      return ThrowException(Utils::GetException(ret));
-    }
-    return Undefined();
+    return BZ2_bzCompressInit(&stream_, blockSize100k, 0, workFactor);
   }
 
 
-  int Write(char *data, int &dataLength, Blob &out, bool flush) {
+  int Write(char *data, size_t &dataLength, Blob &out, bool flush) {
     out.setUseBufferOut(want_buffer_);
+    // Finish only with the last slice of input.
+    unsigned int slice = SliceLength(dataLength);
+    flush = flush && slice == dataLength;
     stream_.next_in = data;
-    stream_.avail_in = dataLength;
+    stream_.avail_in = slice;
     stream_.next_out = out.data() + out.length();
-    size_t initAvail = stream_.avail_out = out.avail();
+    size_t initAvail = stream_.avail_out = SliceLength(out.avail());
 
     int ret = BZ2_bzCompress(&stream_, flush ? BZ_FINISH : BZ_RUN);
-    dataLength = stream_.avail_in;
+    dataLength -= slice - stream_.avail_in;
     if (!Utils::IsError(ret)) {
       out.IncreaseLengthBy(initAvail - stream_.avail_out);
     }
@@ -195,7 +210,7 @@ class BzipImpl {
   int Finish(Blob &out) {
     out.setUseBufferOut(want_buffer_);
     stream_.next_out = out.data() + out.length();
-    size_t initAvail = stream_.avail_out = out.avail();
+    size_t initAvail = stream_.avail_out = SliceLength(out.avail());
 
     int ret = BZ2_bzCompress(&stream_, BZ_FINISH);
     if (!Utils::IsError(ret)) {
@@ -223,6 +238,7 @@ class BunzipImpl {
  public:
 #endif
   friend class ZipLib<BunzipImpl>;
+  friend class Codec<BunzipImpl>;
 
   typedef BzipUtils Utils;
   typedef BzipUtils::Blob Blob;
@@ -244,29 +260,41 @@ class BunzipImpl {
       want_buffer_ = args[1]->BooleanValue() ? true : false;
     }
 
+    int ret = InitStream(small);
+    if (Utils::IsError(ret)) {
+      return ThrowException(Utils::GetException(ret));
+    }
+    return Undefined();
+  }
+
+
+  int Init(int level) {
+    want_buffer_ = true;
+    return InitStream(0);
+  }
+
+
+  int InitStream(int small) {
     stream_.bzalloc = NULL;
     stream_.bzfree = NULL;
     stream_.opaque = NULL;
     stream_.avail_in = 0;
     stream_.next_in = NULL;
 
-    int ret = BZ2_bzDecompressInit(&stream_, 0, small);
-    if (Utils::IsError(ret)) {
-      return ThrowException(Utils::GetException(ret));
-    }
-    return Undefined();
+    return BZ2_bzDecompressInit(&stream_, 0, small);
   }
 
 
-  int Write(const char *data, int &dataLength, Blob &out, bool flush) {
+  int Write(const char *data, size_t &dataLength, Blob &out, bool flush) {
     out.setUseBufferOut(want_buffer_);
+    unsigned int slice = SliceLength(dataLength);
     stream_.next_in = const_cast<char*>(data);
-    stream_.avail_in = dataLength;
+    stream_.avail_in = slice;
     stream_.next_out = out.data() + out.length();
-    size_t initAvail = stream_.avail_out = out.avail();
+    size_t initAvail = stream_.avail_out = SliceLength(out.avail());
 
     int ret = BZ2_bzDecompress(&stream_);
-    dataLength = stream_.avail_in;
+    dataLength -= slice - stream_.avail_in;
     if (!Utils::IsError(ret)) {
       out.IncreaseLengthBy(initAvail - stream_.avail_out);
     }
@@ -274,9 +302,10 @@ class BunzipImpl {
   }
 
 
+  // Reaching Finish means stream end wasn't seen in input.
   int Finish(Blob &out) {
     out.setUseBufferOut(want_buffer_);
-    return BZ_OK;
+    return BZ_UNEXPECTED_EOF;
   }
 
 
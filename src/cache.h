@@ -0,0 +1,402 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NODE_COMPRESS_CACHE_H__
+#define NODE_COMPRESS_CACHE_H__
+
+#include <new>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <node.h>
+
+using namespace v8;
+
+// Process-wide cache of compressed outputs keyed by 128-bit hash of input
+// and codec parameters, evicting least recently used entries above byte
+// limit.  Disabled until setOutputCache(maxBytes) is called.  Entries are
+// reference counted, so Buffers made from them with FreeBuffer() share
+// memory with the cache and outlive eviction.
+class OutputCache {
+ public:
+  struct Key {
+    uint64_t h1;
+    uint64_t h2;
+    uint64_t length;
+
+    bool operator==(const Key &other) const {
+      return h1 == other.h1 && h2 == other.h2 && length == other.length;
+    }
+  };
+
+  class Entry {
+   public:
+    const char *data() const {
+      return data_;
+    }
+
+    size_t length() const {
+      return length_;
+    }
+
+    void Ref() {
+      __sync_fetch_and_add(&refs_, 1);
+    }
+
+    void Unref() {
+      if (__sync_sub_and_fetch(&refs_, 1) == 0) {
+        free(data_);
+        delete this;
+      }
+    }
+
+   private:
+    friend class OutputCache;
+
+    Entry(const Key &key, char *data, size_t length)
+      : key_(key), data_(data), length_(length), refs_(1), indexed_(false),
+      prev_(0), next_(0), chain_(0)
+    {}
+
+    Key key_;
+    char *data_;
+    size_t length_;
+    volatile int refs_;
+
+    bool indexed_;
+    Entry *prev_;
+    Entry *next_;
+    Entry *chain_;
+  };
+
+  enum { InitialBuckets = 1024 };
+
+ public:
+  static bool Enabled() {
+    return max_bytes_ != 0;
+  }
+
+
+  // params distinguishes codecs and settings producing different output.
+  static Key MakeKey(const char *data, size_t length, uint64_t params) {
+    Key key;
+    Hash(reinterpret_cast<const uint8_t*>(data), length, params,
+        key.h1, key.h2);
+    key.length = length;
+    return key;
+  }
+
+
+  // Returns referenced entry or 0.
+  static Entry *Find(const Key &key) {
+    pthread_mutex_lock(&mutex_);
+    Entry *entry = 0;
+    if (buckets_ != 0) {
+      for (entry = buckets_[Bucket(key)]; entry != 0; entry = entry->chain_) {
+        if (entry->key_ == key) {
+          break;
+        }
+      }
+    }
+    if (entry != 0) {
+      entry->Ref();
+      Unlink(entry);
+      PushFront(entry);
+      ++hits_;
+    } else {
+      ++misses_;
+    }
+    pthread_mutex_unlock(&mutex_);
+    return entry;
+  }
+
+
+  // Takes ownership of malloc'ed data and returns referenced entry holding
+  // it, which is kept in cache if it fits.  Returns 0 and frees data if out
+  // of memory.
+  static Entry *Insert(const Key &key, char *data, size_t length) {
+    Entry *entry = new(std::nothrow) Entry(key, data, length);
+    if (entry == 0) {
+      free(data);
+      return 0;
+    }
+
+    pthread_mutex_lock(&mutex_);
+    if (max_bytes_ != 0 && length <= max_bytes_ && Reserve()) {
+      Entry **slot = &buckets_[Bucket(key)];
+      for (; *slot != 0; slot = &(*slot)->chain_) {
+        if ((*slot)->key_ == key) {
+          // Lost race with another thread compressing the same input.
+          Remove(*slot);
+          break;
+        }
+      }
+      entry->Ref();
+      entry->indexed_ = true;
+      entry->chain_ = buckets_[Bucket(key)];
+      buckets_[Bucket(key)] = entry;
+      PushFront(entry);
+      bytes_ += length;
+      ++entries_;
+      ++inserts_;
+      Evict();
+    }
+    pthread_mutex_unlock(&mutex_);
+    return entry;
+  }
+
+
+  // Wraps malloc'ed data into referenced entry not kept in cache, for code
+  // passing entries to FreeBuffer() whether the cache is used or not.
+  static Entry *Hold(char *data, size_t length) {
+    Key key = { 0, 0, 0 };
+    Entry *entry = new(std::nothrow) Entry(key, data, length);
+    if (entry == 0) {
+      free(data);
+    }
+    return entry;
+  }
+
+
+  // Buffer::free_callback for Buffers sharing entry data, hint is the entry.
+  static void FreeBuffer(char *data, void *hint) {
+    static_cast<Entry*>(hint)->Unref();
+  }
+
+
+  // setOutputCache(maxBytes) sets the limit and returns the previous one, 0
+  // disables the cache and drops its entries.
+  static Handle<Value> SetOutputCache(const Arguments &args) {
+    HandleScope scope;
+
+    if (args.Length() < 1 || !args[0]->IsNumber() ||
+        args[0]->IntegerValue() < 0) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("maxBytes must be a non-negative number"));
+      return ThrowException(exception);
+    }
+
+    pthread_mutex_lock(&mutex_);
+    Local<Value> previous = Number::New(static_cast<double>(max_bytes_));
+    max_bytes_ = args[0]->IntegerValue();
+    Evict();
+    pthread_mutex_unlock(&mutex_);
+    return scope.Close(previous);
+  }
+
+
+  static Handle<Value> GetOutputCacheStats(const Arguments &args) {
+    HandleScope scope;
+
+    pthread_mutex_lock(&mutex_);
+    Local<Object> result = Object::New();
+    result->Set(String::NewSymbol("hits"), Number::New(hits_));
+    result->Set(String::NewSymbol("misses"), Number::New(misses_));
+    result->Set(String::NewSymbol("inserts"), Number::New(inserts_));
+    result->Set(String::NewSymbol("evictions"), Number::New(evictions_));
+    result->Set(String::NewSymbol("entries"), Number::New(entries_));
+    result->Set(String::NewSymbol("bytes"), Number::New(bytes_));
+    result->Set(String::NewSymbol("maxBytes"), Number::New(max_bytes_));
+    pthread_mutex_unlock(&mutex_);
+    return scope.Close(result);
+  }
+
+ private:
+  // MurmurHash3 x64 128-bit, seeded with params.
+  static void Hash(const uint8_t *data, size_t length, uint64_t seed,
+      uint64_t &out1, uint64_t &out2) {
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+
+    size_t blocks = length / 16;
+    for (size_t i = 0; i < blocks; ++i) {
+      uint64_t k1, k2;
+      memcpy(&k1, data + i * 16, 8);
+      memcpy(&k2, data + i * 16 + 8, 8);
+
+      k1 *= c1; k1 = Rotl(k1, 31); k1 *= c2; h1 ^= k1;
+      h1 = Rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+      k2 *= c2; k2 = Rotl(k2, 33); k2 *= c1; h2 ^= k2;
+      h2 = Rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const uint8_t *tail = data + blocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    for (size_t i = length & 15; i > 8; --i) {
+      k2 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 9) * 8);
+    }
+    for (size_t i = (length & 15) < 8 ? length & 15 : 8; i > 0; --i) {
+      k1 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 1) * 8);
+    }
+    if ((length & 15) > 8) {
+      k2 *= c2; k2 = Rotl(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+    if ((length & 15) != 0) {
+      k1 *= c1; k1 = Rotl(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= length;
+    h2 ^= length;
+    h1 += h2;
+    h2 += h1;
+    h1 = Mix(h1);
+    h2 = Mix(h2);
+    h1 += h2;
+    h2 += h1;
+    out1 = h1;
+    out2 = h2;
+  }
+
+
+  static uint64_t Rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+  }
+
+
+  static uint64_t Mix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+  }
+
+
+  static size_t Bucket(const Key &key) {
+    return key.h1 & (bucket_count_ - 1);
+  }
+
+
+  // Keeps load factor at most 1.  Called with mutex held.
+  static bool Reserve() {
+    if (buckets_ != 0 && entries_ < bucket_count_) {
+      return true;
+    }
+    size_t count = buckets_ != 0 ? bucket_count_ * 2 : InitialBuckets;
+    Entry **buckets = new(std::nothrow) Entry*[count];
+    if (buckets == 0) {
+      return buckets_ != 0;
+    }
+    memset(buckets, 0, count * sizeof(Entry*));
+    for (size_t i = 0; buckets_ != 0 && i < bucket_count_; ++i) {
+      Entry *entry = buckets_[i];
+      while (entry != 0) {
+        Entry *next = entry->chain_;
+        size_t bucket = entry->key_.h1 & (count - 1);
+        entry->chain_ = buckets[bucket];
+        buckets[bucket] = entry;
+        entry = next;
+      }
+    }
+    delete[] buckets_;
+    buckets_ = buckets;
+    bucket_count_ = count;
+    return true;
+  }
+
+
+  // Called with mutex held.
+  static void Evict() {
+    while (tail_ != 0 && (bytes_ > max_bytes_ || max_bytes_ == 0)) {
+      Remove(tail_);
+      ++evictions_;
+    }
+  }
+
+
+  // Drops entry from index and LRU list.  Called with mutex held.
+  static void Remove(Entry *entry) {
+    Entry **slot = &buckets_[Bucket(entry->key_)];
+    while (*slot != entry) {
+      slot = &(*slot)->chain_;
+    }
+    *slot = entry->chain_;
+    Unlink(entry);
+    entry->indexed_ = false;
+    bytes_ -= entry->length_;
+    --entries_;
+    entry->Unref();
+  }
+
+
+  static void Unlink(Entry *entry) {
+    if (entry->prev_ != 0) {
+      entry->prev_->next_ = entry->next_;
+    } else {
+      head_ = entry->next_;
+    }
+    if (entry->next_ != 0) {
+      entry->next_->prev_ = entry->prev_;
+    } else {
+      tail_ = entry->prev_;
+    }
+    entry->prev_ = 0;
+    entry->next_ = 0;
+  }
+
+
+  static void PushFront(Entry *entry) {
+    entry->next_ = head_;
+    if (head_ != 0) {
+      head_->prev_ = entry;
+    } else {
+      tail_ = entry;
+    }
+    head_ = entry;
+  }
+
+ private:
+  static pthread_mutex_t mutex_;
+  static Entry **buckets_;
+  static size_t bucket_count_;
+  static Entry *head_;
+  static Entry *tail_;
+
+  static uint64_t max_bytes_;
+  static uint64_t bytes_;
+  static uint64_t entries_;
+  static uint64_t hits_;
+  static uint64_t misses_;
+  static uint64_t inserts_;
+  static uint64_t evictions_;
+};
+pthread_mutex_t OutputCache::mutex_ = PTHREAD_MUTEX_INITIALIZER;
+OutputCache::Entry **OutputCache::buckets_ = 0;
+size_t OutputCache::bucket_count_ = 0;
+OutputCache::Entry *OutputCache::head_ = 0;
+OutputCache::Entry *OutputCache::tail_ = 0;
+uint64_t OutputCache::max_bytes_ = 0;
+uint64_t OutputCache::bytes_ = 0;
+uint64_t OutputCache::entries_ = 0;
+uint64_t OutputCache::hits_ = 0;
+uint64_t OutputCache::misses_ = 0;
+uint64_t OutputCache::inserts_ = 0;
+uint64_t OutputCache::evictions_ = 0;
+
+#endif
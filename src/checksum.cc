@@ -0,0 +1,244 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <node.h>
+#include <node_buffer.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "utils.h"
+#include "checksum.h"
+
+using namespace v8;
+using namespace node;
+
+// crc32(buffer, [initial], callback), adler32(buffer, [initial], callback):
+// checksum in the thread pool.  Buffers of several SplitSize are cut into
+// parts computed in parallel and merged with combine.
+// crc32Combine(crcA, crcB, lengthB), adler32Combine(...): synchronous merge
+// of checksums of adjacent parts.
+class AsyncChecksum {
+ private:
+  enum {
+    SplitSize = 4 << 20,
+    MaxParts = 8
+  };
+
+  struct Batch;
+
+  struct Part {
+    Batch *batch;
+    const char *data;
+    size_t length;
+    uint32_t value;
+  };
+
+  struct Batch {
+    Batch(Local<Value> inputBuffer, Local<Function> callback, bool crc,
+        uint32_t initial)
+      : buffer(Persistent<Value>::New(inputBuffer)),
+      callback(Persistent<Function>::New(callback)),
+      crc(crc), initial(initial), parts(0), pending(0)
+    {}
+
+    ~Batch() {
+      buffer.Dispose();
+      callback.Dispose();
+    }
+
+    Persistent<Value> buffer;
+    Persistent<Function> callback;
+    bool crc;
+    uint32_t initial;
+    int parts;
+    int pending;
+    Part part[MaxParts];
+  };
+
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    NODE_SET_METHOD(target, "crc32", Crc32);
+    NODE_SET_METHOD(target, "adler32", Adler32);
+    NODE_SET_METHOD(target, "crc32Combine", Crc32Combine);
+    NODE_SET_METHOD(target, "adler32Combine", Adler32Combine);
+  }
+
+ private:
+  static Handle<Value> Crc32(const Arguments &args) {
+    HandleScope scope;
+    return Schedule(args, true);
+  }
+
+
+  static Handle<Value> Adler32(const Arguments &args) {
+    HandleScope scope;
+    return Schedule(args, false);
+  }
+
+
+  static Handle<Value> Crc32Combine(const Arguments &args) {
+    HandleScope scope;
+    uint32_t a, b;
+    uint64_t length;
+    if (!CombineArgs(args, a, b, length)) {
+      return ThrowException(Exception::TypeError(
+            String::New("Checksums and length must be numbers")));
+    }
+    return scope.Close(Integer::NewFromUnsigned(
+          Checksum::Crc32Combine(a, b, length)));
+  }
+
+
+  static Handle<Value> Adler32Combine(const Arguments &args) {
+    HandleScope scope;
+    uint32_t a, b;
+    uint64_t length;
+    if (!CombineArgs(args, a, b, length)) {
+      return ThrowException(Exception::TypeError(
+            String::New("Checksums and length must be numbers")));
+    }
+    return scope.Close(Integer::NewFromUnsigned(
+          Checksum::Adler32Combine(a, b, length)));
+  }
+
+
+  static bool CombineArgs(const Arguments &args, uint32_t &a, uint32_t &b,
+      uint64_t &length) {
+    if (args.Length() < 3 || !args[0]->IsNumber() || !args[1]->IsNumber() ||
+        !args[2]->IsNumber() || args[2]->IntegerValue() < 0) {
+      return false;
+    }
+    a = args[0]->Uint32Value();
+    b = args[1]->Uint32Value();
+    length = args[2]->IntegerValue();
+    return true;
+  }
+
+
+  static Handle<Value> Schedule(const Arguments &args, bool crc) {
+    if (args.Length() < 2 || !Buffer::HasInstance(args[0])) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Input must be of type Buffer"));
+      return ThrowException(exception);
+    }
+    if (!args[args.Length() - 1]->IsFunction()) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Callback must be a function"));
+      return ThrowException(exception);
+    }
+
+    uint32_t initial = crc ? 0 : 1;
+    if (args.Length() > 2 && !args[1]->IsUndefined()) {
+      if (!args[1]->IsNumber()) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("Initial value must be a number"));
+        return ThrowException(exception);
+      }
+      initial = args[1]->Uint32Value();
+    }
+
+    Batch *batch = new(std::nothrow) Batch(args[0],
+        Local<Function>::Cast(args[args.Length() - 1]), crc, initial);
+    if (batch == 0) {
+      V8::LowMemoryNotification();
+      return ThrowException(Exception::Error(
+            String::New("Insufficient space")));
+    }
+
+    Local<Object> buffer = args[0]->ToObject();
+    const char *data = Buffer::Data(buffer);
+    size_t length = Buffer::Length(buffer);
+
+    // Parts no smaller than SplitSize, so combining stays negligible.
+    size_t parts = length / SplitSize;
+    if (parts < 1) {
+      parts = 1;
+    } else if (parts > MaxParts) {
+      parts = MaxParts;
+    }
+    size_t step = length / parts;
+
+    batch->parts = batch->pending = (int)parts;
+    for (size_t i = 0; i < parts; ++i) {
+      Part &part = batch->part[i];
+      part.batch = batch;
+      part.data = data + i * step;
+      part.length = i + 1 < parts ? step : length - i * step;
+      part.value = crc ? 0 : 1;
+      eio_custom(DoProcess, EIO_PRI_DEFAULT, DoHandleCallback, &part);
+      ev_ref(EV_DEFAULT_UC);
+    }
+    return Undefined();
+  }
+
+
+  // Executed in worker thread.
+  static int DoProcess(eio_req *req) {
+    Part *part = reinterpret_cast<Part*>(req->data);
+    if (part->batch->crc) {
+      part->value = Checksum::Crc32(part->value, part->data, part->length);
+    } else {
+      part->value = Checksum::Adler32(part->value, part->data, part->length);
+    }
+    return 0;
+  }
+
+
+  // Executed in V8 thread, calls back after the last part.
+  static int DoHandleCallback(eio_req *req) {
+    Part *part = reinterpret_cast<Part*>(req->data);
+    Batch *batch = part->batch;
+    ev_unref(EV_DEFAULT_UC);
+    if (--batch->pending > 0) {
+      return 0;
+    }
+
+    uint32_t value = batch->initial;
+    for (int i = 0; i < batch->parts; ++i) {
+      if (batch->crc) {
+        value = Checksum::Crc32Combine(value, batch->part[i].value,
+            batch->part[i].length);
+      } else {
+        value = Checksum::Adler32Combine(value, batch->part[i].value,
+            batch->part[i].length);
+      }
+    }
+
+    HandleScope scope;
+    Local<Value> argv[2];
+    argv[0] = Local<Value>::New(Undefined());
+    argv[1] = Integer::NewFromUnsigned(value);
+
+    TryCatch try_catch;
+    batch->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+    if (try_catch.HasCaught()) {
+      FatalException(try_catch);
+    }
+
+    delete batch;
+    return 0;
+  }
+};
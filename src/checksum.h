@@ -0,0 +1,415 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef NODE_COMPRESS_CHECKSUM_H__
+#define NODE_COMPRESS_CHECKSUM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "utils.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define CHECKSUM_X86_SIMD 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+// CRC-32 (gzip, zlib's crc32()) and Adler-32 with zlib compatible values,
+// so results can be mixed with zlib and gzip trailers.  Kernels are picked
+// once at load time: PCLMULQDQ folding for CRC-32 (SSE4.2 crc32 instruction
+// computes CRC-32C, a different polynomial) and SSSE3 for Adler-32, falling
+// back to slicing-by-8 and unrolled scalar code.  Doesn't touch V8.
+class Checksum {
+ public:
+  typedef uint32_t (*Kernel)(uint32_t, const unsigned char*, size_t);
+
+ public:
+  // Continue crc of preceding data (0 for none) with data.
+  static uint32_t Crc32(uint32_t crc, const char *data, size_t length) {
+    return ~Instance().crc32_(~crc,
+        reinterpret_cast<const unsigned char*>(data), length);
+  }
+
+
+  // Continue adler of preceding data (1 for none) with data.
+  static uint32_t Adler32(uint32_t adler, const char *data, size_t length) {
+    return Instance().adler32_(adler,
+        reinterpret_cast<const unsigned char*>(data), length);
+  }
+
+
+  // CRC-32 of concatenation of A and B given crc of both and length of B.
+  static uint32_t Crc32Combine(uint32_t crcA, uint32_t crcB,
+      uint64_t lengthB) {
+    return MultModP(X2nModP(lengthB, 3), crcA) ^ crcB;
+  }
+
+
+  static uint32_t Adler32Combine(uint32_t adlerA, uint32_t adlerB,
+      uint64_t lengthB) {
+    uint32_t rem = (uint32_t)(lengthB % Base);
+    uint32_t sum1 = adlerA & 0xffff;
+    uint32_t sum2 = (rem * sum1) % Base;
+    sum1 += (adlerB & 0xffff) + Base - 1;
+    sum2 += (adlerA >> 16) + (adlerB >> 16) + Base - rem;
+    if (sum1 >= Base) sum1 -= Base;
+    if (sum1 >= Base) sum1 -= Base;
+    if (sum2 >= (Base << 1)) sum2 -= (Base << 1);
+    if (sum2 >= Base) sum2 -= Base;
+    return sum1 | (sum2 << 16);
+  }
+
+
+  static const char *Crc32Name() {
+    return Instance().crc32_name_;
+  }
+
+
+  static const char *Adler32Name() {
+    return Instance().adler32_name_;
+  }
+
+ public:
+  // Kernels work on raw (not inverted) CRC register.
+  static uint32_t Crc32Slice8(uint32_t crc, const unsigned char *p,
+      size_t length) {
+    const uint32_t (*t)[256] = Instance().crc_table_;
+    while (length && ((uintptr_t)p & 7)) {
+      crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+      --length;
+    }
+    while (length >= 8) {
+      uint32_t lo, hi;
+      memcpy(&lo, p, 4);
+      memcpy(&hi, p + 4, 4);
+      lo ^= crc;
+      crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+          t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+          t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+          t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+      p += 8;
+      length -= 8;
+    }
+    while (length--) {
+      crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+  }
+
+
+  static uint32_t Adler32Scalar(uint32_t adler, const unsigned char *p,
+      size_t length) {
+    uint32_t s1 = adler & 0xffff;
+    uint32_t s2 = adler >> 16;
+    while (length > 0) {
+      size_t n = length < NMax ? length : NMax;
+      length -= n;
+      while (n >= 8) {
+        s2 += (s1 += p[0]);
+        s2 += (s1 += p[1]);
+        s2 += (s1 += p[2]);
+        s2 += (s1 += p[3]);
+        s2 += (s1 += p[4]);
+        s2 += (s1 += p[5]);
+        s2 += (s1 += p[6]);
+        s2 += (s1 += p[7]);
+        p += 8;
+        n -= 8;
+      }
+      while (n--) {
+        s2 += (s1 += *p++);
+      }
+      s1 %= Base;
+      s2 %= Base;
+    }
+    return s1 | (s2 << 16);
+  }
+
+#ifdef CHECKSUM_X86_SIMD
+  // Folds four 128-bit lanes with carry-less multiplies and reduces with
+  // Barrett, as in Intel's "Fast CRC Computation for Generic Polynomials
+  // Using PCLMULQDQ Instruction".  Constants are for bit-reflected 0x04c11db7.
+  __attribute__((target("pclmul,sse4.1")))
+  static uint32_t Crc32Pclmul(uint32_t crc, const unsigned char *p,
+      size_t length) {
+    COND_RETURN(length < 64, Crc32Slice8(crc, p, length));
+
+    static const uint64_t k1k2[2] __attribute__((aligned(16))) =
+        { 0x0154442bd4ULL, 0x01c6e41596ULL };
+    static const uint64_t k3k4[2] __attribute__((aligned(16))) =
+        { 0x01751997d0ULL, 0x00ccaa009eULL };
+    static const uint64_t k5k0[2] __attribute__((aligned(16))) =
+        { 0x0163cd6124ULL, 0x0000000000ULL };
+    static const uint64_t poly[2] __attribute__((aligned(16))) =
+        { 0x01db710641ULL, 0x01f7011641ULL };
+
+    size_t tail = length & 15;
+    length -= tail;
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+    x1 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+    x0 = _mm_load_si128((const __m128i*)k1k2);
+    p += 64;
+    length -= 64;
+
+    while (length >= 64) {
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+      x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+      x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+      x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+      x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+      y5 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+      y6 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+      y7 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+      y8 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+      x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+      x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+      x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+      p += 64;
+      length -= 64;
+    }
+
+    // Fold four lanes into one.
+    x0 = _mm_load_si128((const __m128i*)k3k4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    while (length >= 16) {
+      x2 = _mm_loadu_si128((const __m128i*)p);
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+      p += 16;
+      length -= 16;
+    }
+
+    // 128 to 64 bits.
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits.
+    x0 = _mm_load_si128((const __m128i*)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    crc = (uint32_t)_mm_extract_epi32(x1, 1);
+
+    return Crc32Slice8(crc, p, tail);
+  }
+
+
+  // Sums 32-byte blocks: psadbw for s1, pmaddubsw with descending weights
+  // for s2, reducing modulo Base every NMax bytes.
+  __attribute__((target("ssse3")))
+  static uint32_t Adler32Ssse3(uint32_t adler, const unsigned char *p,
+      size_t length) {
+    const size_t Block = 32;
+    uint32_t s1 = adler & 0xffff;
+    uint32_t s2 = adler >> 16;
+
+    size_t blocks = length / Block;
+    length -= blocks * Block;
+
+    const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+        24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+        8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+
+    while (blocks) {
+      size_t n = NMax / Block;
+      if (n > blocks) {
+        n = blocks;
+      }
+      blocks -= n;
+
+      __m128i v_ps = _mm_set_epi32(0, 0, 0, s1 * (uint32_t)n);
+      __m128i v_s2 = _mm_set_epi32(0, 0, 0, s2);
+      __m128i v_s1 = _mm_setzero_si128();
+      do {
+        const __m128i bytes1 = _mm_loadu_si128((const __m128i*)p);
+        const __m128i bytes2 = _mm_loadu_si128((const __m128i*)(p + 16));
+        v_ps = _mm_add_epi32(v_ps, v_s1);
+        v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+        v_s2 = _mm_add_epi32(v_s2,
+            _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+        v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+        v_s2 = _mm_add_epi32(v_s2,
+            _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+        p += Block;
+      } while (--n);
+
+      v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+      v_s1 = _mm_add_epi32(v_s1,
+          _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(1, 0, 3, 2)));
+      s1 += (uint32_t)_mm_cvtsi128_si32(v_s1);
+      v_s2 = _mm_add_epi32(v_s2,
+          _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(2, 3, 0, 1)));
+      v_s2 = _mm_add_epi32(v_s2,
+          _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(1, 0, 3, 2)));
+      s2 = (uint32_t)_mm_cvtsi128_si32(v_s2);
+
+      s1 %= Base;
+      s2 %= Base;
+    }
+    return Adler32Scalar(s1 | (s2 << 16), p, length);
+  }
+#endif
+
+ private:
+  enum {
+    Base = 65521,
+    // Largest n with 255n(n+1)/2 + (n+1)(Base-1) fitting in 32 bits.
+    NMax = 5552
+  };
+
+  static const uint32_t Poly = 0xedb88320;
+
+ private:
+  Checksum() {
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) {
+        c = c & 1 ? (c >> 1) ^ Poly : c >> 1;
+      }
+      crc_table_[0][n] = c;
+    }
+    for (uint32_t n = 0; n < 256; ++n) {
+      for (int k = 1; k < 8; ++k) {
+        uint32_t c = crc_table_[k - 1][n];
+        crc_table_[k][n] = crc_table_[0][c & 0xff] ^ (c >> 8);
+      }
+    }
+
+    // x2n_table_[k] = x^(2^k) mod P(x).
+    uint32_t p = 1u << 30;
+    x2n_table_[0] = p;
+    for (int k = 1; k < 32; ++k) {
+      x2n_table_[k] = p = MultModP(p, p);
+    }
+
+    crc32_ = Crc32Slice8;
+    crc32_name_ = "slice8";
+    adler32_ = Adler32Scalar;
+    adler32_name_ = "scalar";
+#ifdef CHECKSUM_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+      crc32_ = Crc32Pclmul;
+      crc32_name_ = "pclmul";
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+      adler32_ = Adler32Ssse3;
+      adler32_name_ = "ssse3";
+    }
+#endif
+  }
+
+
+  // Tables are filled during static initialization, before any worker
+  // thread can ask for them.
+  static Checksum &Instance() {
+    return instance_;
+  }
+
+
+  // a * b modulo P(x), both bit-reflected.
+  static uint32_t MultModP(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31, p = 0;
+    for (;;) {
+      if (a & m) {
+        p ^= b;
+        if ((a & (m - 1)) == 0) {
+          break;
+        }
+      }
+      m >>= 1;
+      b = b & 1 ? (b >> 1) ^ Poly : b >> 1;
+    }
+    return p;
+  }
+
+
+  // x^(n * 2^k) modulo P(x).
+  static uint32_t X2nModP(uint64_t n, unsigned k) {
+    uint32_t p = 1u << 31;
+    while (n) {
+      if (n & 1) {
+        p = MultModP(Instance().x2n_table_[k & 31], p);
+      }
+      n >>= 1;
+      ++k;
+    }
+    return p;
+  }
+
+ private:
+  uint32_t crc_table_[8][256];
+  uint32_t x2n_table_[32];
+
+  Kernel crc32_;
+  Kernel adler32_;
+  const char *crc32_name_;
+  const char *adler32_name_;
+
+  static Checksum instance_;
+
+ private:
+  Checksum(Checksum&);
+  Checksum(const Checksum&);
+  Checksum& operator=(Checksum&);
+  Checksum& operator=(const Checksum&);
+};
+Checksum Checksum::instance_;
+
+#endif
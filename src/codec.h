@@ -0,0 +1,232 @@
+/*
+ * Copyright 2010, Ivan Egorov (egorich.3.04@gmail.com).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NODE_COMPRESS_CODEC_H__
+#define NODE_COMPRESS_CODEC_H__
+
+#include <stddef.h>
+
+#include "utils.h"
+
+// Stream state machine driving a Processor: grows output buffers, feeds
+// input until consumed and finalizes the stream.  Doesn't touch V8, so it
+// is usable from worker threads and from native tools (see bench/).
+template <class Processor>
+class Codec {
+ public:
+  enum State {
+    Idle,
+    Destroyed,
+    Data,
+    Eos,
+    Error
+  };
+
+ public:
+  typedef typename Processor::Utils Utils;
+  typedef typename Processor::Blob Blob;
+
+  typedef StateTransition<State> Transition;
+
+ public:
+  // Non-flushing input is fed to the processor in slices of this size, so
+  // Cancel() doesn't wait for the whole write.  Flushing writes go in one
+  // piece to keep single-shot paths of processors.
+  static const size_t CancelSlice = 4 << 20;
+
+ public:
+  Codec()
+    : state_(Idle), calls_(0), cancelled_(0)
+  {
+  }
+
+
+  ~Codec() {
+    this->Destroy();
+  }
+
+
+  Processor &processor() {
+    return processor_;
+  }
+
+
+  State &state() {
+    return state_;
+  }
+
+
+  // Number of calls into the library since the previous call.
+  size_t TakeCalls() {
+    size_t calls = calls_;
+    calls_ = 0;
+    return calls;
+  }
+
+
+  // Makes Write() fail at the next slice, with sequence error, and every
+  // Write() after it.  Called from any thread.
+  void Cancel() {
+    cancelled_ = 1;
+  }
+
+
+  // Initialize processor with codec-specific level, negative for default.
+  int Init(int level) {
+    Transition t(state_, Error);
+    int ret = processor_.Init(level);
+    COND_RETURN(Utils::IsError(ret), ret);
+    t.alter(Data);
+    return ret;
+  }
+
+
+  int Write(char *data, size_t dataLength, Blob &out, bool flush) {
+    DEBUG_P("%p",this);
+    COND_RETURN(state_ != Data, Utils::StatusSequenceError());
+
+    Transition t(state_, Error);
+
+    int ret = Feed(data, dataLength, out, flush, ~(size_t)0);
+    COND_RETURN(Utils::IsError(ret), ret);
+    if (ret == Utils::StatusEndOfStream()) {
+      t.alter(Eos);
+      return ret;
+    }
+    if (flush) {
+      ret = Finish(out);
+      COND_RETURN(Utils::IsError(ret), ret);
+      t.abort();
+      this->Destroy();
+      return Utils::StatusOk();
+    }
+    t.abort();
+    return Utils::StatusOk();
+  }
+
+
+  // Non-flushing Write() returning once out holds limit bytes or more, so
+  // output of one call stays bounded whatever the compression ratio.
+  // dataLength is left at the input not consumed yet.
+  int WriteSome(char *data, size_t &dataLength, Blob &out, size_t limit) {
+    DEBUG_P("%p",this);
+    COND_RETURN(state_ != Data, Utils::StatusSequenceError());
+
+    Transition t(state_, Error);
+
+    int ret = Feed(data, dataLength, out, false, limit);
+    COND_RETURN(Utils::IsError(ret), ret);
+    if (ret == Utils::StatusEndOfStream()) {
+      t.alter(Eos);
+      return ret;
+    }
+    t.abort();
+    return Utils::StatusOk();
+  }
+
+
+  int Close(Blob &out) {
+    DEBUG_P("%p",this);
+    COND_RETURN(state_ == Idle || state_ == Destroyed,
+        Utils::StatusOk());
+
+    Transition t(state_, Error);
+
+    int ret = Utils::StatusOk();
+    if (state_ == Data) {
+      ret = Finish(out);
+    }
+
+    t.abort();
+    this->Destroy();
+    return ret;
+  }
+
+
+  void Destroy() {
+    DEBUG_P("%p",this);
+    if (state_ != Idle && state_ != Destroyed) {
+      this->processor_.Destroy();
+    }
+    state_ = Destroyed;
+  }
+
+ private:
+  // Passes input to the processor until it is consumed, the stream ends or
+  // out holds limit bytes, leaving dataLength at what is left.
+  int Feed(char *data, size_t &dataLength, Blob &out, bool flush,
+      size_t limit) {
+    data += dataLength;
+    int ret = Utils::StatusOk();
+    while (dataLength > 0 && out.length() < limit) {
+      COND_RETURN(cancelled_, Utils::StatusSequenceError());
+      size_t slice = dataLength;
+      if (!flush && slice > CancelSlice) {
+        slice = CancelSlice;
+      }
+
+      // Reused buffers keep their capacity, so grow only what is missing.
+      if (out.avail() <= slice) {
+        COND_RETURN(!out.GrowBy(slice + 1 - out.avail()),
+            Utils::StatusMemoryError());
+      }
+
+      ++calls_;
+      size_t left = slice;
+      ret = this->processor_.Write(data - dataLength, left, out, flush);
+      dataLength -= slice - left;
+
+      COND_RETURN(Utils::IsError(ret), ret);
+      COND_RETURN(ret == Utils::StatusEndOfStream(), ret);
+    }
+    return ret;
+  }
+
+
+  int Finish(Blob &out) {
+    const int Chunk = 4096;
+
+    int ret;
+    do {
+      COND_RETURN(!out.GrowBy(Chunk), Utils::StatusMemoryError());
+
+      ++calls_;
+      ret = this->processor_.Finish(out);
+      COND_RETURN(Utils::IsError(ret), ret);
+    } while (ret != Utils::StatusEndOfStream());
+    return Utils::StatusOk();
+  }
+
+ private:
+  Processor processor_;
+  State state_;
+  size_t calls_;
+  volatile int cancelled_;
+
+ private:
+  Codec(Codec&);
+  Codec(const Codec&);
+  Codec& operator=(Codec&);
+  Codec& operator=(const Codec&);
+};
+
+#endif
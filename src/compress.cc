@@ -23,6 +23,10 @@
 
 #include <node.h>
 
+#include "stats.h"
+#include "trace.h"
+#include "cache.h"
+
 #ifdef WITH_GZIP
 #include "gzip.cc"
 #endif
@@ -31,6 +35,30 @@
 #include "bzip.cc"
 #endif
 
+#ifdef WITH_LZ4
+#include "lz4.cc"
+#endif
+
+#ifdef WITH_ZSTD
+#include "zstd.cc"
+#endif
+
+#ifdef WITH_XZ
+#include "xz.cc"
+#endif
+
+#include "checksum.cc"
+#include "file.cc"
+#include "fanout.cc"
+#include "transcode.cc"
+
+#ifdef WITH_GZIP
+#include "tiered.cc"
+#include "join.cc"
+#include "message.cc"
+#include "batch.cc"
+#endif
+
 extern "C" void
 init (Handle<Object> target) 
 {
@@ -39,11 +67,48 @@ init (Handle<Object> target)
 #ifdef WITH_GZIP
   Gzip::Initialize(target);
   Gunzip::Initialize(target);
+  BufferCodec::Initialize(target);
+  NODE_SET_METHOD(target, "setInflateEngine", GunzipImpl::SetInflateEngine);
 #endif
 
 #ifdef WITH_BZIP
   Bzip::Initialize(target);
   Bunzip::Initialize(target);
 #endif
+
+#ifdef WITH_LZ4
+  Lz4::Initialize(target);
+  Unlz4::Initialize(target);
+#endif
+
+#ifdef WITH_ZSTD
+  Zstd::Initialize(target);
+  Unzstd::Initialize(target);
+  ZstdDictionary::Initialize(target);
+#endif
+
+#ifdef WITH_XZ
+  Xz::Initialize(target);
+  Unxz::Initialize(target);
+#endif
+
+  AsyncChecksum::Initialize(target);
+  FileCodec::Initialize(target);
+  Fanout::Initialize(target);
+  Transcode::Initialize(target);
+#ifdef WITH_GZIP
+  TieredCodec::Initialize(target);
+  GzipJoin::Initialize(target);
+  MessageDeflate::Initialize(target);
+  MessageInflate::Initialize(target);
+  BatchCodec::Initialize(target);
+#endif
+
+  NODE_SET_METHOD(target, "getStats", StatsRegistry::GetStats);
+  NODE_SET_METHOD(target, "setTracing", Tracer::SetTracing);
+  NODE_SET_METHOD(target, "getTrace", Tracer::GetTrace);
+  NODE_SET_METHOD(target, "setOutputCache", OutputCache::SetOutputCache);
+  NODE_SET_METHOD(target, "getOutputCacheStats",
+      OutputCache::GetOutputCacheStats);
 }
 
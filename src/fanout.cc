@@ -0,0 +1,412 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <node.h>
+#include <node_buffer.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "utils.h"
+#include "buffer.h"
+#include "anycodec.h"
+#include "registry.h"
+
+using namespace v8;
+using namespace node;
+
+// Fanout(outputs): one input stream encoded by several codecs at once.
+// outputs is an array of {codec, level, tag} objects, codec is a library
+// name, level is library default if omitted and tag names the output, codec
+// name by default.  write(buffer, callback) and close(callback) pin input
+// once and run every codec on it concurrently in the thread pool, callback
+// receives error and an object mapping tags to output Buffers.  Requests of
+// one object are processed in order.
+class Fanout : ObjectWrap {
+ private:
+  enum {
+    MaxOutputs = 16
+  };
+
+  struct Request {
+    enum Kind {
+      RWrite,
+      RClose,
+      RDestroy
+    };
+
+    Request(Kind kind, Local<Function> callback)
+      : kind(kind), data(0), length(0), next(0)
+    {
+      if (!callback.IsEmpty()) {
+        this->callback = Persistent<Function>::New(callback);
+      }
+    }
+
+    ~Request() {
+      buffer.Dispose();
+      callback.Dispose();
+    }
+
+    Kind kind;
+
+    // Input is pinned once for all branches.
+    Persistent<Value> buffer;
+    char *data;
+    size_t length;
+
+    Persistent<Function> callback;
+    Request *next;
+  };
+
+  // Codec with its output, status of the current request and tag.
+  struct Branch {
+    Branch()
+      : self(0), codec(0), status(0)
+    {}
+
+    ~Branch() {
+      tag.Dispose();
+      delete codec;
+    }
+
+    Fanout *self;
+    AnyCodec *codec;
+    int status;
+    Persistent<Value> tag;
+  };
+
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    constructor_ = Persistent<FunctionTemplate>::New(
+        FunctionTemplate::New(New));
+    constructor_->InstanceTemplate()->SetInternalFieldCount(1);
+
+    NODE_SET_PROTOTYPE_METHOD(constructor_, "write", Write);
+    NODE_SET_PROTOTYPE_METHOD(constructor_, "close", Close);
+    NODE_SET_PROTOTYPE_METHOD(constructor_, "destroy", Destroy);
+
+    NODE_SET_METHOD(constructor_, "createInstance_", Create);
+
+    target->Set(String::NewSymbol("Fanout"), constructor_->GetFunction());
+  }
+
+ private:
+  static Handle<Value> New(const Arguments &args) {
+    HandleScope scope;
+
+    if (args.Length() < 1 || !args[0]->IsArray()) {
+      return ThrowException(Exception::TypeError(
+            String::New("Outputs must be an array")));
+    }
+    Local<Array> outputs = Local<Array>::Cast(args[0]);
+    if (outputs->Length() < 1 || outputs->Length() > MaxOutputs) {
+      return ThrowException(Exception::TypeError(
+            String::New("Number of outputs is out of range")));
+    }
+
+    Fanout *self = new(std::nothrow) Fanout();
+    if (self == 0) {
+      return ThrowGentleOom();
+    }
+    self->Wrap(args.This());
+
+    for (uint32_t i = 0; i < outputs->Length(); ++i) {
+      Local<Value> exception = self->AddBranch(outputs->Get(i));
+      if (!exception.IsEmpty()) {
+        return ThrowException(exception);
+      }
+    }
+    return args.This();
+  }
+
+
+  static Handle<Value> Create(const Arguments &args) {
+    HandleScope scope;
+
+    Handle<Value> arg = args[0];
+    return constructor_->GetFunction()->NewInstance(1, &arg);
+  }
+
+
+  // Returns exception for invalid output spec, empty handle otherwise.
+  Local<Value> AddBranch(Local<Value> spec) {
+    if (!spec->IsObject()) {
+      return Exception::TypeError(String::New("Output must be an object"));
+    }
+    Local<Object> options = spec->ToObject();
+
+    String::AsciiValue name(options->Get(String::NewSymbol("codec")));
+    const CodecRegistry::Entry *entry =
+        *name != 0 ? CodecRegistry::Find(*name) : 0;
+    if (entry == 0) {
+      return Exception::Error(
+          String::New("Library built without support for this codec."));
+    }
+
+    int level = -1;
+    Local<Value> value = options->Get(String::NewSymbol("level"));
+    if (!value->IsUndefined()) {
+      if (!value->IsInt32()) {
+        return Exception::TypeError(String::New("level must be an integer"));
+      }
+      level = value->Int32Value();
+    }
+
+    Local<Value> tag = options->Get(String::NewSymbol("tag"));
+    if (tag->IsUndefined()) {
+      tag = String::New(entry->name);
+    }
+    tag = tag->ToString();
+    for (int i = 0; i < count_; ++i) {
+      if (branches_[i].tag->StrictEquals(tag)) {
+        return Exception::Error(String::New("Duplicate output tag"));
+      }
+    }
+
+    Branch &branch = branches_[count_];
+    branch.self = this;
+    branch.tag = Persistent<Value>::New(tag);
+    branch.codec = entry->compressor();
+    if (branch.codec == 0) {
+      V8::LowMemoryNotification();
+      return Exception::Error(String::New("Insufficient space"));
+    }
+    ++count_;
+
+    int ret = branch.codec->Init(level);
+    if (branch.codec->IsError(ret)) {
+      return branch.codec->GetException(ret);
+    }
+    return Local<Value>();
+  }
+
+
+  static Handle<Value> Write(const Arguments &args) {
+    HandleScope scope;
+
+    if (!Buffer::HasInstance(args[0])) {
+      return ThrowException(Exception::TypeError(
+            String::New("Input must be of type Buffer")));
+    }
+    Local<Function> callback;
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+      if (!args[1]->IsFunction()) {
+        return ThrowCallbackExpected();
+      }
+      callback = Local<Function>::Cast(args[1]);
+    }
+
+    Fanout *self = ObjectWrap::Unwrap<Fanout>(args.This());
+    Request *request = new(std::nothrow) Request(Request::RWrite, callback);
+    if (request != 0) {
+      Local<Object> buffer = args[0]->ToObject();
+      request->buffer = Persistent<Value>::New(buffer);
+      request->data = Buffer::Data(buffer);
+      request->length = Buffer::Length(buffer);
+    }
+    return self->PushRequest(request);
+  }
+
+
+  static Handle<Value> Close(const Arguments &args) {
+    HandleScope scope;
+
+    Local<Function> callback;
+    if (args.Length() > 0 && !args[0]->IsUndefined()) {
+      if (!args[0]->IsFunction()) {
+        return ThrowCallbackExpected();
+      }
+      callback = Local<Function>::Cast(args[0]);
+    }
+
+    Fanout *self = ObjectWrap::Unwrap<Fanout>(args.This());
+    return self->PushRequest(
+        new(std::nothrow) Request(Request::RClose, callback));
+  }
+
+
+  static Handle<Value> Destroy(const Arguments &args) {
+    HandleScope scope;
+
+    Fanout *self = ObjectWrap::Unwrap<Fanout>(args.This());
+    return self->PushRequest(
+        new(std::nothrow) Request(Request::RDestroy, Local<Function>()));
+  }
+
+
+  // Queues request behind the current one, every branch must be done with
+  // a request before the next is started.
+  // Executed in V8 thread.
+  Handle<Value> PushRequest(Request *request) {
+    if (request == 0) {
+      return ThrowGentleOom();
+    }
+
+    if (tail_ != 0) {
+      tail_->next = request;
+    } else {
+      Schedule(request);
+    }
+    tail_ = request;
+    return Undefined();
+  }
+
+
+  void Schedule(Request *request) {
+    current_ = request;
+    pending_ = count_;
+    for (int i = 0; i < count_; ++i) {
+      eio_custom(DoBranch, EIO_PRI_DEFAULT, DoHandleBranch, &branches_[i]);
+      ev_ref(EV_DEFAULT_UC);
+    }
+    Ref();
+  }
+
+
+  // Executed in worker thread.
+  static int DoBranch(eio_req *req) {
+    Branch *branch = reinterpret_cast<Branch*>(req->data);
+    Request *request = branch->self->current_;
+    AnyCodec *codec = branch->codec;
+
+    if (codec == 0) {
+      branch->status = 0;
+      return 0;
+    }
+
+    switch (request->kind) {
+      case Request::RWrite:
+        branch->status = codec->Write(request->data, request->length);
+        break;
+
+      case Request::RClose:
+        branch->status = codec->Close();
+        break;
+
+      case Request::RDestroy:
+        delete codec;
+        branch->codec = 0;
+        branch->status = 0;
+        break;
+    }
+    return 0;
+  }
+
+
+  // Calls back when the last branch is done, then starts the next request.
+  // Executed in V8 thread.
+  static int DoHandleBranch(eio_req *req) {
+    Branch *branch = reinterpret_cast<Branch*>(req->data);
+    Fanout *self = branch->self;
+
+    if (--self->pending_ == 0) {
+      Request *request = self->current_;
+      self->DoCallback(request);
+
+      self->current_ = 0;
+      if (request->next != 0) {
+        self->Schedule(request->next);
+      } else {
+        self->tail_ = 0;
+      }
+      delete request;
+      self->Unref();
+    }
+
+    ev_unref(EV_DEFAULT_UC);
+    return 0;
+  }
+
+
+  void DoCallback(Request *request) {
+    HandleScope scope;
+
+    Local<Value> argv[2];
+    argv[0] = Local<Value>::New(Undefined());
+    Local<Object> outputs = Object::New();
+    for (int i = 0; i < count_; ++i) {
+      Branch &branch = branches_[i];
+      if (branch.codec == 0) {
+        continue;
+      }
+      if (branch.codec->IsError(branch.status)) {
+        if (argv[0]->IsUndefined()) {
+          argv[0] = branch.codec->GetException(branch.status);
+        }
+        branch.codec->Clear();
+        continue;
+      }
+      outputs->Set(branch.tag, TakeBuffer(branch.codec));
+    }
+    argv[1] = argv[0]->IsUndefined() ? Local<Value>(outputs) :
+        Local<Value>::New(Undefined());
+
+    if (!request->callback.IsEmpty()) {
+      TryCatch try_catch;
+      request->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+      if (try_catch.HasCaught()) {
+        FatalException(try_catch);
+      }
+    }
+  }
+
+
+  // Output is handed to Buffer without copying, released with free().
+  static Local<Value> TakeBuffer(AnyCodec *codec) {
+    size_t length = codec->length();
+    return MakeBuffer(length > 0 ? codec->Release() : 0, length,
+        FreeMalloced, 0);
+  }
+
+
+  static Handle<Value> ThrowCallbackExpected() {
+    Local<Value> exception = Exception::TypeError(
+        String::New("Callback must be a function"));
+    return ThrowException(exception);
+  }
+
+ private:
+  Fanout()
+    : ObjectWrap(), count_(0), current_(0), tail_(0), pending_(0)
+  {}
+
+ private:
+  Branch branches_[MaxOutputs];
+  int count_;
+
+  Request *current_;
+  Request *tail_;
+  int pending_;
+
+  static Persistent<FunctionTemplate> constructor_;
+
+ private:
+  Fanout(Fanout&);
+  Fanout(const Fanout&);
+  Fanout& operator=(Fanout&);
+  Fanout& operator=(const Fanout&);
+};
+Persistent<FunctionTemplate> Fanout::constructor_;
@@ -0,0 +1,842 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <node.h>
+#include <node_buffer.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <new>
+
+#include "utils.h"
+#include "buffer.h"
+#include "anycodec.h"
+#include "registry.h"
+#include "checksum.h"
+
+using namespace v8;
+using namespace node;
+
+// compressFile(src, dst, [options], callback),
+// decompressFile(src, dst, [options], callback): file conversion in the
+// thread pool, data never enters V8 heap.  src is a path or a descriptor,
+// dst is a path or null to get output as Buffer.  Options:
+//   codec     library name, 'gzip' by default;
+//   level     compression level, library default if omitted;
+//   threads   gzip compression of big files in that many parallel segments;
+//   start     offset of input range in src, 0 by default;
+//   length    length of input range, up to the end of src by default;
+//   progress  function(bytesIn, bytesOut, size) called between steps.
+// Callback receives error and number of bytes written or output Buffer.
+//
+// Source is mapped and pages are fed to the codec directly, then dropped
+// behind the cursor, so memory use doesn't grow with input size.  pread()
+// into a chunk buffer is used where mapping fails.
+class FileCodec {
+ private:
+  enum {
+    ReadSize = 1 << 20,
+    InflateReadSize = 64 << 10,
+    WriteSize = 1 << 20,
+    StepSize = 16 << 20,
+    MaxBufferSize = 0x3fffffff,
+
+    // Parallel gzip: raw deflate segments primed with preceding window.
+    SegmentSize = 1 << 20,
+    WindowSize = 32768,
+    ParallelMinSize = 4 << 20,
+    MaxThreads = 64
+  };
+
+  struct Job;
+
+  struct Segment {
+    Job *job;
+    uint64_t offset;
+    size_t length;
+    bool last;
+
+    ScopedBlob out;
+    uint32_t crc;
+    int status;
+    int errorno;
+  };
+
+  struct Job {
+    Job(Local<Function> callback, const char *src, int fd, const char *dst,
+        const CodecRegistry::Entry *entry, bool compress, int level,
+        int threads, uint64_t start, int64_t length)
+      : callback(Persistent<Function>::New(callback)),
+      src(src ? strdup(src) : 0), dst(dst ? strdup(dst) : 0), entry(entry),
+      compress(compress), level(level), threads(threads), codec(0),
+      parallel(false), in_fd(fd), own_in_fd(fd < 0), out_fd(-1),
+      start(start), requested(length), size(0), bytes_in(0), bytes_out(0),
+      opened(false), done(false), errorno(0), syscall(0), path(0),
+      codec_failed(false), status(0), map(0), map_size(0), input(0),
+      released(0), buffer(0), staging(0), staged(0), segments(0),
+      scheduled(0), pending(0), crc(0)
+    {}
+
+    ~Job() {
+      callback.Dispose();
+      progress.Dispose();
+      free(src);
+      free(dst);
+      delete codec;
+      free(buffer);
+      free(staging);
+      delete[] segments;
+    }
+
+    bool failed() const {
+      return errorno != 0 || codec_failed;
+    }
+
+    Persistent<Function> callback;
+    Persistent<Function> progress;
+    char *src;
+    char *dst;
+    const CodecRegistry::Entry *entry;
+    bool compress;
+    int level;
+    int threads;
+
+    AnyCodec *codec;
+    bool parallel;
+
+    int in_fd;
+    bool own_in_fd;
+    int out_fd;
+    uint64_t start;
+    int64_t requested;
+    uint64_t size;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    bool opened;
+    bool done;
+
+    int errorno;
+    const char *syscall;
+    const char *path;
+    bool codec_failed;
+    int status;
+
+    char *map;
+    size_t map_size;
+    char *input;
+    size_t released;
+
+    char *buffer;
+    char *staging;
+    size_t staged;
+    ScopedBlob result;
+
+    Segment *segments;
+    int scheduled;
+    int pending;
+    uint32_t crc;
+  };
+
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+
+    NODE_SET_METHOD(target, "compressFile", CompressFile);
+    NODE_SET_METHOD(target, "decompressFile", DecompressFile);
+  }
+
+ private:
+  static Handle<Value> CompressFile(const Arguments &args) {
+    HandleScope scope;
+    return Schedule(args, true);
+  }
+
+
+  static Handle<Value> DecompressFile(const Arguments &args) {
+    HandleScope scope;
+    return Schedule(args, false);
+  }
+
+
+  static Handle<Value> Schedule(const Arguments &args, bool compress) {
+    if (args.Length() < 3 || !(args[0]->IsString() ||
+          (args[0]->IsInt32() && args[0]->Int32Value() >= 0))) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Source must be a path or a file descriptor"));
+      return ThrowException(exception);
+    }
+    if (!args[1]->IsString() && !args[1]->IsNull() &&
+        !args[1]->IsUndefined()) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Destination must be a path or null"));
+      return ThrowException(exception);
+    }
+    if (!args[args.Length() - 1]->IsFunction()) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Callback must be a function"));
+      return ThrowException(exception);
+    }
+
+    const CodecRegistry::Entry *entry = CodecRegistry::Find("gzip");
+    int level = -1;
+    int threads = 1;
+    int64_t start = 0;
+    int64_t length = -1;
+    Local<Value> progress;
+    if (args.Length() > 3 && args[2]->IsObject()) {
+      Local<Object> options = args[2]->ToObject();
+
+      Local<Value> codec = options->Get(String::NewSymbol("codec"));
+      if (!codec->IsUndefined()) {
+        String::AsciiValue name(codec);
+        entry = *name != 0 ? CodecRegistry::Find(*name) : 0;
+        if (entry == 0) {
+          Local<Value> exception = Exception::Error(
+              String::New("Library built without support for this codec."));
+          return ThrowException(exception);
+        }
+      }
+
+      Local<Value> value = options->Get(String::NewSymbol("level"));
+      if (!value->IsUndefined()) {
+        if (!value->IsInt32() || value->Int32Value() < -1) {
+          Local<Value> exception = Exception::TypeError(
+              String::New("level is out of range"));
+          return ThrowException(exception);
+        }
+        level = value->Int32Value();
+      }
+
+      value = options->Get(String::NewSymbol("threads"));
+      if (!value->IsUndefined()) {
+        if (!value->IsInt32() || value->Int32Value() < 1 ||
+            value->Int32Value() > MaxThreads) {
+          Local<Value> exception = Exception::TypeError(
+              String::New("threads is out of range"));
+          return ThrowException(exception);
+        }
+        threads = value->Int32Value();
+      }
+
+      value = options->Get(String::NewSymbol("start"));
+      if (!value->IsUndefined()) {
+        if (!value->IsNumber() || value->IntegerValue() < 0) {
+          Local<Value> exception = Exception::TypeError(
+              String::New("start is out of range"));
+          return ThrowException(exception);
+        }
+        start = value->IntegerValue();
+      }
+
+      value = options->Get(String::NewSymbol("length"));
+      if (!value->IsUndefined()) {
+        if (!value->IsNumber() || value->IntegerValue() < 0) {
+          Local<Value> exception = Exception::TypeError(
+              String::New("length is out of range"));
+          return ThrowException(exception);
+        }
+        length = value->IntegerValue();
+      }
+
+      progress = options->Get(String::NewSymbol("progress"));
+      if (!progress->IsUndefined() && !progress->IsFunction()) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("progress must be a function"));
+        return ThrowException(exception);
+      }
+    }
+    if (entry == 0) {
+      Local<Value> exception = Exception::Error(
+          String::New("Library built without gzip support."));
+      return ThrowException(exception);
+    }
+
+    String::Utf8Value src(args[0]);
+    String::Utf8Value dst(args[1]);
+    bool has_src = args[0]->IsString();
+    bool has_dst = args[1]->IsString();
+    Job *job = new(std::nothrow) Job(
+        Local<Function>::Cast(args[args.Length() - 1]),
+        has_src ? *src : 0, has_src ? -1 : args[0]->Int32Value(),
+        has_dst ? *dst : 0, entry, compress, level, threads, start, length);
+    if (job == 0 || (has_src && job->src == 0) ||
+        (has_dst && job->dst == 0)) {
+      delete job;
+      V8::LowMemoryNotification();
+      return ThrowException(Exception::Error(
+            String::New("Insufficient space")));
+    }
+    if (!progress.IsEmpty() && progress->IsFunction()) {
+      job->progress = Persistent<Function>::New(
+          Local<Function>::Cast(progress));
+    }
+
+    eio_custom(DoStep, EIO_PRI_DEFAULT, DoHandleStep, job);
+    ev_ref(EV_DEFAULT_UC);
+    return Undefined();
+  }
+
+
+  // Executed in worker thread.  Opens files on first call, then converts
+  // until StepSize of input is read or output written.  Decompressors take
+  // smaller chunks to bound output held in memory.
+  static int DoStep(eio_req *req) {
+    Job *job = reinterpret_cast<Job*>(req->data);
+
+    if (!job->opened) {
+      job->opened = true;
+      if (!Open(job)) {
+        Close(job);
+        return 0;
+      }
+      if (job->parallel) {
+        return 0;
+      }
+    }
+
+    size_t chunk = job->compress ? ReadSize : InflateReadSize;
+    uint64_t in_limit = job->bytes_in + StepSize;
+    uint64_t out_limit = job->bytes_out + StepSize;
+    while (!job->done && job->bytes_in < in_limit &&
+        job->bytes_out < out_limit) {
+      char *data;
+      ssize_t n = Fetch(job, job->bytes_in, chunk, job->buffer, &data);
+      if (n < 0) {
+        SetErrno(job, "read", job->src);
+        break;
+      }
+      job->bytes_in += n;
+
+      AnyCodec *codec = job->codec;
+      int ret = n > 0 ? codec->Write(data, n) : codec->Close();
+      if (codec->IsError(ret)) {
+        job->codec_failed = true;
+        job->status = ret;
+        break;
+      }
+      if (n == 0 || codec->IsEnd(ret)) {
+        // Decompressors other than Unzstd stop at the end of the first
+        // stream.
+        if (n > 0) {
+          codec->Close();
+        }
+        job->done = true;
+      }
+      Release(job, job->bytes_in);
+      if (!Append(job, codec->data(), codec->length())) {
+        break;
+      }
+      codec->Clear();
+    }
+
+    if (job->done || job->failed()) {
+      Close(job);
+    }
+    return 0;
+  }
+
+
+  // Executed in V8 thread.
+  static int DoHandleStep(eio_req *req) {
+    HandleScope scope;
+    Job *job = reinterpret_cast<Job*>(req->data);
+
+    if (!job->progress.IsEmpty() && !job->failed()) {
+      Local<Value> argv[3];
+      argv[0] = Number::New(static_cast<double>(job->bytes_in));
+      argv[1] = Number::New(static_cast<double>(job->bytes_out));
+      argv[2] = Number::New(static_cast<double>(job->size));
+
+      TryCatch try_catch;
+      job->progress->Call(Context::GetCurrent()->Global(), 3, argv);
+      if (try_catch.HasCaught()) {
+        FatalException(try_catch);
+      }
+    }
+
+    if (!job->done) {
+      if (job->parallel) {
+        ScheduleSegments(job);
+      } else {
+        eio_custom(DoStep, EIO_PRI_DEFAULT, DoHandleStep, job);
+        ev_ref(EV_DEFAULT_UC);
+      }
+    } else {
+      Local<Value> argv[2];
+      argv[0] = Local<Value>::New(Undefined());
+      argv[1] = Local<Value>::New(Undefined());
+      if (job->errorno != 0) {
+        argv[0] = ErrnoException(job->errorno, job->syscall, "", job->path);
+      } else if (job->codec_failed) {
+        argv[0] = job->codec->GetException(job->status);
+      } else if (job->dst == 0) {
+        argv[1] = TakeBuffer(job->result);
+      } else {
+        argv[1] = Number::New(static_cast<double>(job->bytes_out));
+      }
+
+      TryCatch try_catch;
+      job->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+      if (try_catch.HasCaught()) {
+        FatalException(try_catch);
+      }
+      delete job;
+    }
+
+    ev_unref(EV_DEFAULT_UC);
+    return 0;
+  }
+
+
+  // Output is handed to Buffer without copying, released with free().
+  static Local<Value> TakeBuffer(ScopedBlob &blob) {
+    size_t length = blob.length();
+    return MakeBuffer(length > 0 ? blob.Release() : 0, length,
+        FreeMalloced, 0);
+  }
+
+
+  static bool Open(Job *job) {
+    if (job->own_in_fd) {
+      job->in_fd = open(job->src, O_RDONLY);
+      COND_RETURN(job->in_fd < 0, SetErrno(job, "open", job->src));
+    }
+
+    struct stat in_stat, out_stat;
+    COND_RETURN(fstat(job->in_fd, &in_stat) < 0,
+        SetErrno(job, "fstat", job->src));
+    if (!S_ISREG(in_stat.st_mode)) {
+      errno = EINVAL;
+      return SetErrno(job, "fstat", job->src);
+    }
+    uint64_t file_size = in_stat.st_size;
+    job->size = job->start < file_size ? file_size - job->start : 0;
+    if (job->requested >= 0 &&
+        static_cast<uint64_t>(job->requested) < job->size) {
+      job->size = job->requested;
+    }
+    Map(job);
+
+    if (job->dst != 0) {
+      // Truncating the source itself would lose data.
+      if (stat(job->dst, &out_stat) == 0 &&
+          out_stat.st_dev == in_stat.st_dev &&
+          out_stat.st_ino == in_stat.st_ino) {
+        errno = EINVAL;
+        return SetErrno(job, "open", job->dst);
+      }
+      job->out_fd = open(job->dst, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      COND_RETURN(job->out_fd < 0, SetErrno(job, "open", job->dst));
+
+      void *staging = 0;
+      COND_RETURN(posix_memalign(&staging, 4096, WriteSize) != 0,
+          SetNoMemory(job));
+      job->staging = static_cast<char*>(staging);
+    }
+
+    // Parallel mode doesn't use the codec, but reports errors with it.
+    job->codec = job->compress ? job->entry->compressor() :
+        job->entry->decompressor();
+    COND_RETURN(job->codec == 0, SetNoMemory(job));
+
+#ifdef WITH_GZIP
+    job->parallel = job->compress && job->threads > 1 &&
+        strcmp(job->entry->name, "gzip") == 0 &&
+        job->size >= static_cast<uint64_t>(ParallelMinSize);
+    if (job->parallel) {
+      job->segments = new(std::nothrow) Segment[job->threads];
+      COND_RETURN(job->segments == 0, SetNoMemory(job));
+      return true;
+    }
+#endif
+
+    if (job->input == 0) {
+      job->buffer = static_cast<char*>(malloc(ReadSize));
+      COND_RETURN(job->buffer == 0, SetNoMemory(job));
+    }
+
+    int ret = job->codec->Init(job->level);
+    if (job->codec->IsError(ret)) {
+      job->codec_failed = true;
+      job->status = ret;
+      return false;
+    }
+    return true;
+  }
+
+
+  // Maps input range read-only.  Failure isn't an error: input is read into
+  // a buffer then.
+  static void Map(Job *job) {
+    uint64_t page = sysconf(_SC_PAGESIZE);
+    uint64_t base = job->start & ~(page - 1);
+    uint64_t map_size = job->start - base + job->size;
+    if (job->size == 0 || map_size != static_cast<size_t>(map_size)) {
+      return;
+    }
+
+    void *map = mmap(0, map_size, PROT_READ, MAP_SHARED, job->in_fd, base);
+    if (map == MAP_FAILED) {
+#ifdef POSIX_FADV_SEQUENTIAL
+      posix_fadvise(job->in_fd, job->start, job->size, POSIX_FADV_SEQUENTIAL);
+#endif
+      return;
+    }
+    madvise(map, map_size, MADV_SEQUENTIAL);
+    job->map = static_cast<char*>(map);
+    job->map_size = map_size;
+    job->input = job->map + (job->start - base);
+  }
+
+
+  // Points data at up to length bytes of input at offset in the range,
+  // read into scratch unless input is mapped.
+  static ssize_t Fetch(Job *job, uint64_t offset, size_t length,
+      char *scratch, char **data) {
+    if (offset >= job->size) {
+      return 0;
+    }
+    if (length > job->size - offset) {
+      length = job->size - offset;
+    }
+    if (job->input != 0) {
+      *data = job->input + offset;
+      return length;
+    }
+    *data = scratch;
+    return Read(job->in_fd, scratch, length, job->start + offset);
+  }
+
+
+  // Drops mapped pages of input before offset, they won't be read again.
+  static void Release(Job *job, uint64_t offset) {
+    if (job->map == 0) {
+      return;
+    }
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t end = (job->input - job->map + offset) & ~(page - 1);
+    if (end > job->released) {
+      madvise(job->map + job->released, end - job->released, MADV_DONTNEED);
+      job->released = end;
+    }
+  }
+
+
+  // Flushes buffered output and closes files, partial output is removed on
+  // error.
+  static void Close(Job *job) {
+    job->done = true;
+    if (!job->failed() && job->staged > 0) {
+      FlushStaging(job);
+    }
+    if (job->map != 0) {
+      munmap(job->map, job->map_size);
+      job->map = 0;
+      job->input = 0;
+    }
+    if (job->in_fd >= 0 && job->own_in_fd) {
+      close(job->in_fd);
+      job->in_fd = -1;
+    }
+    if (job->out_fd >= 0) {
+      if (close(job->out_fd) < 0 && !job->failed()) {
+        SetErrno(job, "close", job->dst);
+      }
+      job->out_fd = -1;
+      if (job->failed()) {
+        unlink(job->dst);
+      }
+    }
+  }
+
+
+  // File output goes through aligned staging buffer, so all but the last
+  // write are WriteSize long and aligned in the file.
+  static bool Append(Job *job, const char *data, size_t length) {
+    if (job->dst == 0) {
+      return AppendResult(job, data, length);
+    }
+
+    while (length > 0) {
+      size_t n = WriteSize - job->staged;
+      if (n > length) {
+        n = length;
+      }
+      memcpy(job->staging + job->staged, data, n);
+      job->staged += n;
+      data += n;
+      length -= n;
+      if (job->staged == WriteSize && !FlushStaging(job)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
+  static bool AppendResult(Job *job, const char *data, size_t length) {
+    ScopedBlob &result = job->result;
+    if (result.length() + length > MaxBufferSize) {
+      errno = EFBIG;
+      return SetErrno(job, "write", 0);
+    }
+    if (result.avail() < length) {
+      size_t grow = result.capacity() > length ? result.capacity() : length;
+      COND_RETURN(!result.GrowBy(grow), SetNoMemory(job));
+    }
+    if (length > 0) {
+      memcpy(result.data() + result.length(), data, length);
+    }
+    result.IncreaseLengthBy(length);
+    job->bytes_out += length;
+    return true;
+  }
+
+
+  static bool FlushStaging(Job *job) {
+    const char *data = job->staging;
+    size_t length = job->staged;
+    while (length > 0) {
+      ssize_t n = write(job->out_fd, data, length);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      COND_RETURN(n < 0, SetErrno(job, "write", job->dst));
+      data += n;
+      length -= n;
+    }
+    job->bytes_out += job->staged;
+    job->staged = 0;
+    return true;
+  }
+
+
+  static ssize_t Read(int fd, char *data, size_t length, off_t offset) {
+    size_t total = 0;
+    while (total < length) {
+      ssize_t n = pread(fd, data + total, length - total, offset + total);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      COND_RETURN(n < 0, -1);
+      if (n == 0) {
+        break;
+      }
+      total += n;
+    }
+    return total;
+  }
+
+
+  static bool SetErrno(Job *job, const char *syscall, const char *path) {
+    if (job->errorno == 0) {
+      job->errorno = errno;
+      job->syscall = syscall;
+      job->path = path;
+    }
+    return false;
+  }
+
+
+  static bool SetNoMemory(Job *job) {
+    errno = ENOMEM;
+    return SetErrno(job, "malloc", 0);
+  }
+
+
+#ifdef WITH_GZIP
+  // Executed in V8 thread.  Starts next round of up to threads segments,
+  // the last one to finish schedules writing of their output.
+  static void ScheduleSegments(Job *job) {
+    uint64_t offset = job->bytes_in;
+    job->scheduled = 0;
+    for (int i = 0; i < job->threads && offset < job->size; ++i) {
+      Segment &segment = job->segments[i];
+      segment.job = job;
+      segment.offset = offset;
+      segment.length = job->size - offset < SegmentSize ?
+          job->size - offset : SegmentSize;
+      segment.last = offset + segment.length >= job->size;
+      segment.crc = 0;
+      segment.status = Z_OK;
+      segment.errorno = 0;
+      offset += segment.length;
+      ++job->scheduled;
+    }
+    job->pending = job->scheduled;
+    for (int i = 0; i < job->scheduled; ++i) {
+      eio_custom(DoSegment, EIO_PRI_DEFAULT, DoHandleSegment,
+          &job->segments[i]);
+      ev_ref(EV_DEFAULT_UC);
+    }
+  }
+
+
+  // Executed in worker thread.  Segment is a raw deflate stream primed with
+  // preceding window and ended with sync flush, so segments concatenate
+  // into one stream; the last one finishes it.
+  static int DoSegment(eio_req *req) {
+    Segment *segment = reinterpret_cast<Segment*>(req->data);
+    Job *job = segment->job;
+
+    size_t window = segment->offset < WindowSize ?
+        segment->offset : WindowSize;
+    size_t length = window + segment->length;
+    char *scratch = 0;
+    if (job->input == 0) {
+      scratch = static_cast<char*>(malloc(length));
+      if (scratch == 0) {
+        segment->status = Z_MEM_ERROR;
+        return 0;
+      }
+    }
+
+    char *data;
+    ssize_t n = Fetch(job, segment->offset - window, length, scratch, &data);
+    if (n != static_cast<ssize_t>(length)) {
+      // Source shrunk under us.
+      segment->errorno = n < 0 ? errno : EIO;
+      free(scratch);
+      return 0;
+    }
+
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    int ret = deflateInit2(&stream, job->level, Z_DEFLATED, -MAX_WBITS, 8,
+        Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) {
+      segment->status = ret;
+      free(scratch);
+      return 0;
+    }
+    if (window > 0) {
+      deflateSetDictionary(&stream, reinterpret_cast<Bytef*>(data), window);
+    }
+
+    ScopedBlob &out = segment->out;
+    int flush = segment->last ? Z_FINISH : Z_SYNC_FLUSH;
+    stream.next_in = reinterpret_cast<Bytef*>(data + window);
+    stream.avail_in = segment->length;
+    do {
+      if (out.avail() < 64 &&
+          !out.GrowBy(deflateBound(&stream, stream.avail_in) + 64)) {
+        ret = Z_MEM_ERROR;
+        break;
+      }
+      stream.next_out = reinterpret_cast<Bytef*>(out.data()) + out.length();
+      stream.avail_out = out.avail();
+      ret = deflate(&stream, flush);
+      out.IncreaseLengthBy(out.avail() - stream.avail_out);
+    } while (ret == Z_OK && (stream.avail_in > 0 || stream.avail_out == 0 ||
+          flush == Z_FINISH));
+    if (ret == (flush == Z_FINISH ? Z_STREAM_END : Z_OK)) {
+      ret = Z_OK;
+      segment->crc = Checksum::Crc32(0, data + window, segment->length);
+    }
+    segment->status = ret;
+
+    deflateEnd(&stream);
+    free(scratch);
+    return 0;
+  }
+
+
+  // Executed in V8 thread.
+  static int DoHandleSegment(eio_req *req) {
+    Segment *segment = reinterpret_cast<Segment*>(req->data);
+    Job *job = segment->job;
+
+    if (--job->pending == 0) {
+      eio_custom(DoWriteSegments, EIO_PRI_DEFAULT, DoHandleStep, job);
+      ev_ref(EV_DEFAULT_UC);
+    }
+    ev_unref(EV_DEFAULT_UC);
+    return 0;
+  }
+
+
+  // Executed in worker thread.  Writes compressed segments in order with
+  // gzip header before the first and trailer after the last one.
+  static int DoWriteSegments(eio_req *req) {
+    Job *job = reinterpret_cast<Job*>(req->data);
+
+    if (job->bytes_in == 0) {
+      // No name or time, extra flags and OS code as zlib sets them.
+      char header[10] = { '\x1f', '\x8b', Z_DEFLATED, 0, 0, 0, 0, 0, 0, 3 };
+      header[8] = job->level == 9 ? 2 : (job->level == 1 ? 4 : 0);
+      Append(job, header, sizeof(header));
+    }
+
+    bool last = false;
+    for (int i = 0; i < job->scheduled && !job->failed(); ++i) {
+      Segment &segment = job->segments[i];
+      if (segment.errorno != 0) {
+        errno = segment.errorno;
+        SetErrno(job, "read", job->src);
+      } else if (segment.status != Z_OK) {
+        job->codec_failed = true;
+        job->status = segment.status;
+      } else if (Append(job, segment.out.data(), segment.out.length())) {
+        job->crc = Checksum::Crc32Combine(job->crc, segment.crc,
+            segment.length);
+        job->bytes_in += segment.length;
+        last = segment.last;
+      }
+    }
+    for (int i = 0; i < job->scheduled; ++i) {
+      job->segments[i].out.Free();
+    }
+    // Next round still needs the window before its first segment.
+    Release(job, job->bytes_in > WindowSize ? job->bytes_in - WindowSize : 0);
+
+    if (last && !job->failed()) {
+      char trailer[8];
+      uint32_t values[2] = {
+        job->crc, static_cast<uint32_t>(job->bytes_in & 0xffffffff)
+      };
+      for (int i = 0; i < 8; ++i) {
+        trailer[i] = static_cast<char>(values[i / 4] >> (8 * (i % 4)));
+      }
+      Append(job, trailer, sizeof(trailer));
+    }
+
+    if (last || job->failed()) {
+      Close(job);
+    }
+    return 0;
+  }
+#else
+  static void ScheduleSegments(Job *job) {
+    assert(0);
+  }
+#endif
+};
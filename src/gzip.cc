@@ -30,7 +30,17 @@
 #include <zlib.h>
 
 #include "utils.h"
+#include "buffer.h"
 #include "zlib.h"
+#include "oneshot.h"
+#include "stats.h"
+#include "cache.h"
+#include "checksum.h"
+#include "slab.h"
+
+#ifdef WITH_ISAL
+#include "isal.h"
+#endif
 
 using namespace v8;
 using namespace node;
@@ -112,11 +122,22 @@ const char GzipUtils::VersionError[] = "Z_VERSION_ERROR: "
   "Invalid library version.";
 
 
+// Whole-buffer compression results are shared by deflateBuffer() and
+// single-write Gzip streams, so both use the same key.
+static inline OutputCache::Key OneShotCacheKey(OneShot::Format format,
+    int level, const char *data, size_t length) {
+  uint64_t params = (uint64_t)'Z' << 56 | (uint64_t)format << 8 |
+      (uint8_t)level;
+  return OutputCache::MakeKey(data, length, params);
+}
+
+
 class GzipImpl {
 #ifdef NEED_PUBLIC_FRIEND
  public:
 #endif
   friend class ZipLib<GzipImpl>;
+  friend class Codec<GzipImpl>;
 
   typedef GzipUtils Utils;
   typedef GzipUtils::Blob Blob;
@@ -159,12 +180,7 @@ class GzipImpl {
       }
     }
 
-    stream_.zalloc = Z_NULL;
-    stream_.zfree = Z_NULL;
-    stream_.opaque = Z_NULL;
-    DEBUG_P("strm:%p", (void*)&stream_);
-    int ret = deflateInit2(&stream_, level,
-                           Z_DEFLATED, gzip_header + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    int ret = InitStream(level, gzip_header);
     if (Utils::IsError(ret)) {
       return ThrowException(Utils::GetException(ret));
     }
@@ -172,21 +188,71 @@ class GzipImpl {
   }
 
 
-  int Write(char *data, int &dataLength, Blob &out, bool flush) {
+  int Init(int level) {
+    want_buffer_ = true;
+    return InitStream(level < 0 ? Z_DEFAULT_COMPRESSION : level, 16);
+  }
+
+
+  // Deflate state is allocated by the first write, see Allocate().
+  int InitStream(int level, int gzip_header) {
+    COND_RETURN(level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION,
+        Z_STREAM_ERROR);
+    level_ = level;
+    format_ = gzip_header ? OneShot::Gzip : OneShot::Zlib;
+    fresh_ = true;
+    done_ = false;
+    allocated_ = false;
+    raw_ = false;
+    check_ = 0;
+    total_ = 0;
+    return Z_OK;
+  }
+
+
+  int Write(char *data, size_t &dataLength, Blob &out, bool flush) {
     out.setUseBufferOut(want_buffer_);
+
+    // Whole stream is given at once, compress it in one call.
+    if (flush && fresh_) {
+      fresh_ = false;
+      int ret = OutputCache::Enabled() ?
+          CompressCached(data, dataLength, out) :
+          OneShot::Compress(format_, level_, data, dataLength, out);
+      if (!Utils::IsError(ret)) {
+        dataLength = 0;
+        done_ = true;
+      }
+      return ret;
+    }
+    fresh_ = false;
+
+    int ret = Allocate(out);
+    COND_RETURN(Utils::IsError(ret), ret);
+
+    // Finish only with the last slice of input.
+    unsigned int slice = SliceLength(dataLength);
+    flush = flush && slice == dataLength;
     stream_.next_in = reinterpret_cast<Bytef*>(data);
-    stream_.avail_in = dataLength;
+    stream_.avail_in = slice;
     stream_.next_out = out.data() + out.length();
-    size_t initAvail = stream_.avail_out = out.avail();
+    size_t initAvail = stream_.avail_out = SliceLength(out.avail());
 
     DEBUG_P("deflate strm:%p flush?%s stream{next_in:%p avail_in:%d next_out:%p avail_out:%d} out{length():%d capacity():%d}", (void*)&stream_, flush?"yes":"no", stream_.next_in, stream_.avail_in, stream_.next_out, stream_.avail_out, out.length(), out.capacity());
-    int ret = deflate(&stream_, flush ? Z_FINISH : Z_NO_FLUSH);
+    ret = deflate(&stream_, flush ? Z_FINISH : Z_NO_FLUSH);
     DEBUG_P("post-deflate strm:%p flush?%s stream{next_in:%p avail_in:%d next_out:%p avail_out:%d} wrote:%d ret:%d out{length():%d capacity():%d}", (void*)&stream_, flush?"yes":"no", stream_.next_in, stream_.avail_in, stream_.next_out, stream_.avail_out, initAvail - stream_.avail_out, ret, out.length(), out.capacity());
 
     if (!Utils::IsError(ret)) {
       DEBUG_P("post-deflate strm:%p ret is OK will assert %d+%d <= %d", (void*)&stream_, out.length(), initAvail - stream_.avail_out, out.capacity());
-      dataLength = stream_.avail_in;
+      if (raw_) {
+        Track(data, slice - stream_.avail_in);
+      }
+      dataLength -= slice - stream_.avail_in;
       out.IncreaseLengthBy(initAvail - stream_.avail_out);
+      if (ret == Z_STREAM_END) {
+        done_ = true;
+        COND_RETURN(raw_ && !AppendTrailer(out), Z_MEM_ERROR);
+      }
     }
     return ret;
   }
@@ -194,53 +260,320 @@ class GzipImpl {
 
   int Finish(Blob &out) {
     out.setUseBufferOut(want_buffer_);
+    COND_RETURN(done_, Z_STREAM_END);
+
+    int ret = Allocate(out);
+    COND_RETURN(Utils::IsError(ret), ret);
+
     stream_.avail_in = 0;
     stream_.next_in = NULL;
     stream_.next_out = out.data() + out.length();
-    int initAvail = stream_.avail_out = out.avail();
+    int initAvail = stream_.avail_out = SliceLength(out.avail());
 
     DEBUG_P("deflate strm:%p stream{next_in:%p avail_in:%d next_out:%p avail_out:%d} out{length():%d capacity():%d}", (void*)&stream_, stream_.next_in, stream_.avail_in, stream_.next_out, stream_.avail_out, out.length(), out.capacity());
-    int ret = deflate(&stream_, Z_FINISH);
+    ret = deflate(&stream_, Z_FINISH);
     DEBUG_P("post-deflate strm:%p stream{next_in:%p avail_in:%d next_out:%p avail_out:%d} wrote:%d ret:%d out{length():%d capacity():%d}", (void*)&stream_, stream_.next_in, stream_.avail_in, stream_.next_out, stream_.avail_out, initAvail - stream_.avail_out, ret, out.length(), out.capacity());
     if (!Utils::IsError(ret)) {
       out.IncreaseLengthBy(initAvail - stream_.avail_out);
+      if (ret == Z_STREAM_END) {
+        done_ = true;
+        COND_RETURN(raw_ && !AppendTrailer(out), Z_MEM_ERROR);
+      }
     }
     return ret;
   }
 
 
   void Destroy() {
+    if (allocated_) {
+      deflateEnd(&stream_);
+      allocated_ = false;
+    }
+    stash_.Free();
+  }
+
+
+  // Ends compressed data so far on a byte boundary and releases deflate
+  // state, keeping the output for the next request.  Stream continues as
+  // raw deflate with an empty window, and check value and length are kept
+  // here to write the trailer.
+  int Hibernate() {
+    COND_RETURN(!allocated_ || done_, Z_OK);
+    if (!raw_) {
+      check_ = stream_.adler;
+      total_ = stream_.total_in;
+    }
+
+    const int Chunk = 4096;
+    int ret;
+    do {
+      if (stash_.avail() < (size_t)Chunk) {
+        COND_RETURN(!stash_.GrowBy(Chunk), Z_MEM_ERROR);
+      }
+      stream_.avail_in = 0;
+      stream_.next_in = NULL;
+      stream_.next_out = stash_.data() + stash_.length();
+      size_t initAvail = stream_.avail_out = stash_.avail();
+      ret = deflate(&stream_, Z_SYNC_FLUSH);
+      COND_RETURN(Utils::IsError(ret) && ret != Z_BUF_ERROR, ret);
+      stash_.IncreaseLengthBy(initAvail - stream_.avail_out);
+    } while (stream_.avail_out == 0);
+
     deflateEnd(&stream_);
+    allocated_ = false;
+    raw_ = true;
+    return Z_OK;
+  }
+
+
+  // Replaces stream state with a copy of source's.
+  int Copy(GzipImpl &source) {
+    Destroy();
+    want_buffer_ = source.want_buffer_;
+    level_ = source.level_;
+    format_ = source.format_;
+    fresh_ = source.fresh_;
+    done_ = source.done_;
+    raw_ = source.raw_;
+    check_ = source.check_;
+    total_ = source.total_;
+
+    if (source.stash_.length() > 0) {
+      COND_RETURN(!stash_.GrowBy(source.stash_.length()), Z_MEM_ERROR);
+      memcpy(stash_.data(), source.stash_.data(), source.stash_.length());
+      stash_.IncreaseLengthBy(source.stash_.length());
+    }
+    COND_RETURN(!source.allocated_, Z_OK);
+
+    int ret = deflateCopy(&stream_, &source.stream_);
+    if (ret != Z_OK) {
+      // Failed copy may still point at source's state.
+      memset(&stream_, 0, sizeof(stream_));
+      return ret;
+    }
+    allocated_ = true;
+    return ret;
+  }
+
+ private:
+  // Allocates deflate state from the slab on first use and after
+  // hibernation, also passing on output kept by Hibernate().
+  int Allocate(Blob &out) {
+    if (stash_.length() > 0) {
+      if (out.avail() < stash_.length()) {
+        COND_RETURN(!out.GrowBy(stash_.length() - out.avail()), Z_MEM_ERROR);
+      }
+      memcpy(out.data() + out.length(), stash_.data(), stash_.length());
+      out.IncreaseLengthBy(stash_.length());
+      stash_.Free();
+    }
+    // Codec guarantees room for output, restore it if stash took it.
+    if (out.avail() == 0) {
+      COND_RETURN(!out.GrowBy(4096), Z_MEM_ERROR);
+    }
+    COND_RETURN(allocated_, Z_OK);
+
+    stream_.zalloc = Slab::Alloc;
+    stream_.zfree = Slab::Free;
+    stream_.opaque = Z_NULL;
+    int bits = raw_ ? -MAX_WBITS :
+        (format_ == OneShot::Gzip ? 16 : 0) + MAX_WBITS;
+    DEBUG_P("strm:%p", (void*)&stream_);
+    int ret = deflateInit2(&stream_, level_, Z_DEFLATED, bits, 8,
+        Z_DEFAULT_STRATEGY);
+    COND_RETURN(ret != Z_OK, ret);
+    allocated_ = true;
+    return Z_OK;
+  }
+
+
+  // Raw deflate after hibernation leaves check value to us.
+  void Track(const char *data, size_t length) {
+    check_ = format_ == OneShot::Gzip ?
+        Checksum::Crc32(check_, data, length) :
+        Checksum::Adler32(check_, data, length);
+    total_ += length;
+  }
+
+
+  bool AppendTrailer(Blob &out) {
+    Bytef trailer[8];
+    int n = 0;
+    if (format_ == OneShot::Gzip) {
+      for (int i = 0; i < 4; ++i) {
+        trailer[n++] = (Bytef)(check_ >> (8 * i));
+      }
+      for (int i = 0; i < 4; ++i) {
+        trailer[n++] = (Bytef)(total_ >> (8 * i));
+      }
+    } else {
+      for (int i = 3; i >= 0; --i) {
+        trailer[n++] = (Bytef)(check_ >> (8 * i));
+      }
+    }
+    if (out.avail() < (size_t)n) {
+      COND_RETURN(!out.GrowBy(n - out.avail()), false);
+    }
+    memcpy(out.data() + out.length(), trailer, n);
+    out.IncreaseLengthBy(n);
+    return true;
+  }
+
+
+  // Stream output is copied from the cache entry, as ZipLib owns the Blob.
+  int CompressCached(const char *data, size_t length, Blob &out) {
+    OutputCache::Key key = OneShotCacheKey(format_, level_, data, length);
+    OutputCache::Entry *entry = OutputCache::Find(key);
+    if (entry == 0) {
+      Blob fresh;
+      int ret = OneShot::Compress(format_, level_, data, length, fresh);
+      COND_RETURN(Utils::IsError(ret), ret);
+
+      size_t size = fresh.length();
+      entry = OutputCache::Insert(key,
+          reinterpret_cast<char*>(fresh.Release()), size);
+      COND_RETURN(entry == 0, Z_MEM_ERROR);
+    }
+
+    if (out.avail() < entry->length() &&
+        !out.GrowBy(entry->length() - out.avail())) {
+      entry->Unref();
+      return Z_MEM_ERROR;
+    }
+    memcpy(out.data() + out.length(), entry->data(), entry->length());
+    out.IncreaseLengthBy(entry->length());
+    entry->Unref();
+    return Z_STREAM_END;
   }
 
  private:
   bool want_buffer_;
   z_stream stream_;
+
+  // For whole-buffer path.
+  int level_;
+  OneShot::Format format_;
+  bool fresh_;
+  bool done_;
+
+  // Deflate state is released while idle, see Hibernate().
+  bool allocated_;
+  bool raw_;
+  uLong check_;
+  uLong total_;
+  Blob stash_;
 };
 const char GzipImpl::Name[] = "Gzip";
 typedef ZipLib<GzipImpl> Gzip;
 
 
+// Deflate state goes back to the slab until the next write.
+template <>
+inline void ZipLib<GzipImpl>::DoHibernate(Request *request) {
+  int ret = Z_OK;
+  if (codec_.state() == Stream::Data) {
+    ret = codec_.processor().Hibernate();
+    if (Utils::IsError(ret)) {
+      codec_.state() = Stream::Error;
+    }
+  }
+  request->setStatus(ret);
+}
+
+
+// Deflate state is cloned with deflateCopy(), so data written so far, like
+// a shared prefix, is compressed once for all forks.
+template <>
+inline Handle<Value> ZipLib<GzipImpl>::Fork(const Arguments &args) {
+  HandleScope scope;
+
+  Self *self = ObjectWrap::Unwrap<Self>(args.This());
+  if (self->tail_req_ != 0) {
+    Local<Value> exception = Exception::Error(
+        String::New("fork() requires no pending requests"));
+    return ThrowException(exception);
+  }
+  if (self->codec_.state() != Stream::Data) {
+    Local<Value> exception = Exception::Error(
+        String::New("fork() requires an open stream"));
+    return ThrowException(exception);
+  }
+
+  Local<Object> handle = Self::constructor_->GetFunction()->NewInstance();
+  if (handle.IsEmpty()) {
+    return Undefined();
+  }
+  Self *result = ObjectWrap::Unwrap<Self>(handle);
+  int ret = result->codec_.processor().Copy(self->codec_.processor());
+  if (Utils::IsError(ret)) {
+    result->codec_.state() = Stream::Error;
+    return ThrowException(Utils::GetException(ret));
+  }
+  return scope.Close(handle);
+}
+
+
 class GunzipImpl {
 #ifdef NEED_PUBLIC_FRIEND
  public:
 #endif
   friend class ZipLib<GunzipImpl>;
+  friend class Codec<GunzipImpl>;
 
   typedef GzipUtils Utils;
   typedef GzipUtils::Blob Blob;
 
+ public:
+  // Streaming inflate implementation, chosen for new streams.
+  enum Engine {
+    ZlibEngine,
+    IsalEngine
+  };
+
+  static bool SetEngine(Engine engine) {
+#ifndef WITH_ISAL
+    COND_RETURN(engine == IsalEngine, false);
+#endif
+    engine_ = engine;
+    return true;
+  }
+
+
+  // setInflateEngine(['zlib'|'isal']) returns engine in use before the call.
+  static Handle<Value> SetInflateEngine(const Arguments &args) {
+    HandleScope scope;
+
+    Local<String> previous = String::New(
+        engine_ == IsalEngine ? "isal" : "zlib");
+    if (args.Length() > 0 && !args[0]->IsUndefined()) {
+      String::AsciiValue name(args[0]);
+      bool ok = false;
+      if (*name != 0 && strcmp(*name, "zlib") == 0) {
+        ok = SetEngine(ZlibEngine);
+      } else if (*name != 0 && strcmp(*name, "isal") == 0) {
+        ok = SetEngine(IsalEngine);
+        if (!ok) {
+          Local<Value> exception = Exception::Error(
+              String::New("Library built without ISA-L support."));
+          return ThrowException(exception);
+        }
+      }
+      if (!ok) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("engine must be one of 'zlib', 'isal'"));
+        return ThrowException(exception);
+      }
+    }
+    return scope.Close(previous);
+  }
+
  private:
   static const char Name[];
+  static Engine engine_;
 
  private:
   Handle<Value> Init(const Arguments &args) {
     int gzip_header = 32; // auto-detect by default
-    stream_.zalloc = Z_NULL;
-    stream_.zfree = Z_NULL;
-    stream_.opaque = Z_NULL;
-    stream_.avail_in = 0;
-    stream_.next_in = Z_NULL;
 
     want_buffer_ = false;
     if (args.Length() > 0) {
@@ -260,7 +593,7 @@ class GunzipImpl {
         gzip_header = (args[1]->BooleanValue()) ? 16 : 0;
       }
     }
-    int ret = inflateInit2(&stream_, gzip_header + MAX_WBITS);
+    int ret = InitStream(gzip_header);
     if (Utils::IsError(ret)) {
       return ThrowException(Utils::GetException(ret));
     }
@@ -268,15 +601,60 @@ class GunzipImpl {
   }
 
 
-  int Write(char* data, int &dataLength, Blob &out, bool flush) {
+  int Init(int level) {
+    want_buffer_ = true;
+    return InitStream(32);
+  }
+
+
+  int InitStream(int gzip_header) {
+    format_ = gzip_header == 32 ? OneShot::Auto :
+        (gzip_header ? OneShot::Gzip : OneShot::Zlib);
+    fresh_ = true;
+    done_ = false;
+#ifdef WITH_ISAL
+    use_isal_ = engine_ == IsalEngine;
+    if (use_isal_) {
+      return isal_.Init(gzip_header);
+    }
+#endif
+    stream_.zalloc = Z_NULL;
+    stream_.zfree = Z_NULL;
+    stream_.opaque = Z_NULL;
+    stream_.avail_in = 0;
+    stream_.next_in = Z_NULL;
+    return inflateInit2(&stream_, gzip_header + MAX_WBITS);
+  }
+
+
+  int Write(char* data, size_t &dataLength, Blob &out, bool flush) {
     out.setUseBufferOut(want_buffer_);
+
+    // Whole stream is given at once, decompress it in one call.
+    if (flush && fresh_) {
+      fresh_ = false;
+      int ret = OneShot::Decompress(format_, data, dataLength, out);
+      if (!Utils::IsError(ret)) {
+        dataLength = 0;
+        done_ = true;
+      }
+      return ret;
+    }
+    fresh_ = false;
+
+#ifdef WITH_ISAL
+    if (use_isal_) {
+      return isal_.Write(data, dataLength, out);
+    }
+#endif
+    unsigned int slice = SliceLength(dataLength);
     stream_.next_in = reinterpret_cast<Bytef*>(data);
-    stream_.avail_in = dataLength;
+    stream_.avail_in = slice;
     stream_.next_out = out.data() + out.length();
-    size_t initAvail = stream_.avail_out = out.avail();
+    size_t initAvail = stream_.avail_out = SliceLength(out.avail());
 
     int ret = inflate(&stream_, Z_NO_FLUSH); // flush means nothing here.
-    dataLength = stream_.avail_in;
+    dataLength -= slice - stream_.avail_in;
     if (!Utils::IsError(ret)) {
       out.IncreaseLengthBy(initAvail - stream_.avail_out);
     }
@@ -284,20 +662,265 @@ class GunzipImpl {
   }
 
 
+  // Reaching Finish means stream end wasn't seen in input.
   int Finish(Blob &out) {
     out.setUseBufferOut(want_buffer_);
-    return Z_OK;
+    return done_ ? Z_STREAM_END : Z_BUF_ERROR;
   }
 
 
   void Destroy() {
+#ifdef WITH_ISAL
+    if (use_isal_) {
+      isal_.Destroy();
+      return;
+    }
+#endif
     inflateEnd(&stream_);
   }
 
  private:
   bool want_buffer_;
   z_stream stream_;
+
+  // For whole-buffer path.
+  OneShot::Format format_;
+  bool fresh_;
+  bool done_;
+
+#ifdef WITH_ISAL
+  IsalInflate isal_;
+  bool use_isal_;
+#endif
 };
 const char GunzipImpl::Name[] = "Gunzip";
+#ifdef WITH_ISAL
+GunzipImpl::Engine GunzipImpl::engine_ = GunzipImpl::IsalEngine;
+#else
+GunzipImpl::Engine GunzipImpl::engine_ = GunzipImpl::ZlibEngine;
+#endif
 typedef ZipLib<GunzipImpl> Gunzip;
 
+
+
+// deflateBuffer(buffer, [format], [level], callback) and
+// inflateBuffer(buffer, [format], callback): whole-buffer (de)compression
+// on the thread pool, see OneShot.  Callback receives (exc, Buffer).
+class BufferCodec {
+ private:
+  struct Request {
+    Request(Local<Value> inputBuffer, Local<Function> callback,
+        bool compress, OneShot::Format format, int level)
+      : buffer_(Persistent<Value>::New(inputBuffer)),
+      data_(Buffer::Data(inputBuffer->ToObject())),
+      length_(Buffer::Length(inputBuffer->ToObject())),
+      callback_(Persistent<Function>::New(callback)),
+      compress_(compress), format_(format), level_(level),
+      cached_(0), status_(Z_OK), queued_at_(NowNs())
+    {}
+
+    ~Request() {
+      buffer_.Dispose();
+      callback_.Dispose();
+      if (cached_ != 0) {
+        cached_->Unref();
+      }
+    }
+
+    Persistent<Value> buffer_;
+    char *data_;
+    size_t length_;
+    Persistent<Function> callback_;
+
+    bool compress_;
+    OneShot::Format format_;
+    int level_;
+
+    OneShot::Blob out_;
+    OutputCache::Entry *cached_;
+    int status_;
+    uint64_t queued_at_;
+  };
+
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    NODE_SET_METHOD(target, "deflateBuffer", Deflate);
+    NODE_SET_METHOD(target, "inflateBuffer", Inflate);
+
+    StatsRegistry::Register("deflateBuffer", &deflate_stats_);
+    StatsRegistry::Register("inflateBuffer", &inflate_stats_);
+  }
+
+ private:
+  static Handle<Value> Deflate(const Arguments &args) {
+    HandleScope scope;
+    return Schedule(args, true);
+  }
+
+
+  static Handle<Value> Inflate(const Arguments &args) {
+    HandleScope scope;
+    return Schedule(args, false);
+  }
+
+
+  static Handle<Value> Schedule(const Arguments &args, bool compress) {
+    if (args.Length() < 2 || !Buffer::HasInstance(args[0])) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Input must be of type Buffer"));
+      return ThrowException(exception);
+    }
+    if (!args[args.Length() - 1]->IsFunction()) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Callback must be a function"));
+      return ThrowException(exception);
+    }
+
+    OneShot::Format format = compress ? OneShot::Gzip : OneShot::Auto;
+    if (args.Length() > 2 && !args[1]->IsUndefined()) {
+      String::AsciiValue name(args[1]);
+      if (*name == 0 || !ParseFormat(*name, compress, format)) {
+        Local<Value> exception = Exception::TypeError(String::New(compress ?
+              "format must be one of 'gzip', 'zlib', 'raw'" :
+              "format must be one of 'auto', 'gzip', 'zlib', 'raw'"));
+        return ThrowException(exception);
+      }
+    }
+
+    int level = -1;
+    if (compress && args.Length() > 3 && !args[2]->IsUndefined()) {
+      if (!args[2]->IsInt32() || args[2]->Int32Value() < -1 ||
+          args[2]->Int32Value() > OneShot::MaxLevel) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("level is out of range"));
+        return ThrowException(exception);
+      }
+      level = args[2]->Int32Value();
+    }
+
+    Request *request = new(std::nothrow) Request(args[0],
+        Local<Function>::Cast(args[args.Length() - 1]), compress, format,
+        level);
+    if (request == 0) {
+      V8::LowMemoryNotification();
+      return ThrowException(Exception::Error(
+            String::New("Insufficient space")));
+    }
+
+    eio_custom(DoProcess, EIO_PRI_DEFAULT, DoHandleCallback, request);
+    ev_ref(EV_DEFAULT_UC);
+    return Undefined();
+  }
+
+
+  static bool ParseFormat(const char *name, bool compress,
+      OneShot::Format &format) {
+    if (strcmp(name, "gzip") == 0) {
+      format = OneShot::Gzip;
+    } else if (strcmp(name, "zlib") == 0) {
+      format = OneShot::Zlib;
+    } else if (strcmp(name, "raw") == 0) {
+      format = OneShot::Raw;
+    } else if (!compress && strcmp(name, "auto") == 0) {
+      format = OneShot::Auto;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+
+  // Executed in worker thread.
+  static int DoProcess(eio_req *req) {
+    Request *request = reinterpret_cast<Request*>(req->data);
+    CodecStats &stats = request->compress_ ? deflate_stats_ : inflate_stats_;
+
+    uint64_t start = NowNs();
+    if (request->compress_ && OutputCache::Enabled()) {
+      request->status_ = CompressCached(request);
+    } else if (request->compress_) {
+      request->status_ = OneShot::Compress(request->format_, request->level_,
+          request->data_, request->length_, request->out_);
+    } else {
+      request->status_ = OneShot::Decompress(request->format_,
+          request->data_, request->length_, request->out_);
+    }
+
+    CodecStats::Add(stats.requests, 1);
+    CodecStats::Add(stats.codec_calls, 1);
+    CodecStats::Add(stats.queue_wait_ns, start - request->queued_at_);
+    CodecStats::Add(stats.write_ns, NowNs() - start);
+    CodecStats::Add(stats.bytes_in, request->length_);
+    CodecStats::Add(stats.bytes_out, request->cached_ != 0 ?
+        request->cached_->length() : request->out_.length());
+    CodecStats::Add(stats.reallocs, request->out_.reallocs());
+    if (GzipUtils::IsError(request->status_)) {
+      stats.AddError(request->status_);
+    }
+    return 0;
+  }
+
+
+  // Executed in worker thread.  Both hit and miss leave output in cache
+  // entry, which is then passed to Buffer without copying.
+  static int CompressCached(Request *request) {
+    OutputCache::Key key = OneShotCacheKey(request->format_, request->level_,
+        request->data_, request->length_);
+    request->cached_ = OutputCache::Find(key);
+    COND_RETURN(request->cached_ != 0, Z_STREAM_END);
+
+    OneShot::Blob &out = request->out_;
+    int ret = OneShot::Compress(request->format_, request->level_,
+        request->data_, request->length_, out);
+    COND_RETURN(GzipUtils::IsError(ret), ret);
+
+    size_t length = out.length();
+    request->cached_ = OutputCache::Insert(key,
+        reinterpret_cast<char*>(out.Release()), length);
+    COND_RETURN(request->cached_ == 0, Z_MEM_ERROR);
+    return ret;
+  }
+
+
+  // Executed in V8 thread.
+  static int DoHandleCallback(eio_req *req) {
+    HandleScope scope;
+    Request *request = reinterpret_cast<Request*>(req->data);
+
+    Local<Value> argv[2];
+    argv[0] = GzipUtils::GetException(request->status_);
+    argv[1] = Local<Value>::New(Undefined());
+    if (request->cached_ != 0) {
+      // Buffer takes over request's reference to the entry.
+      OutputCache::Entry *entry = request->cached_;
+      request->cached_ = 0;
+      argv[1] = MakeBuffer(const_cast<char*>(entry->data()),
+          entry->length(), OutputCache::FreeBuffer, entry);
+    } else if (!GzipUtils::IsError(request->status_)) {
+      OneShot::Blob &out = request->out_;
+      Buffer *slowBuffer = Buffer::New(out.length());
+      if (out.length() > 0) {
+        memcpy(Buffer::Data(slowBuffer), out.data(), out.length());
+      }
+      argv[1] = MakeBuffer(slowBuffer, 0, out.length());
+    }
+
+    TryCatch try_catch;
+    request->callback_->Call(Context::GetCurrent()->Global(), 2, argv);
+    if (try_catch.HasCaught()) {
+      FatalException(try_catch);
+    }
+
+    delete request;
+    ev_unref(EV_DEFAULT_UC);
+    return 0;
+  }
+
+ private:
+  static CodecStats deflate_stats_;
+  static CodecStats inflate_stats_;
+};
+CodecStats BufferCodec::deflate_stats_;
+CodecStats BufferCodec::inflate_stats_;
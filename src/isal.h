@@ -0,0 +1,115 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef NODE_COMPRESS_ISAL_H__
+#define NODE_COMPRESS_ISAL_H__
+
+#include <new>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+#include <isa-l/igzip_lib.h>
+
+#include "utils.h"
+
+// Streaming inflate on ISA-L igzip, which decodes with SIMD Huffman tables,
+// wide match copies and folded PCLMUL CRC32, picking kernels for the CPU at
+// run time.  Mirrors the zlib inflate() contract used by GunzipImpl and
+// reports zlib status codes, so it is a drop-in for it.
+class IsalInflate {
+ public:
+  typedef ScopedOutputBuffer<Bytef> Blob;
+
+ public:
+  IsalInflate()
+    : state_(0)
+  {}
+
+  // gzip_header as for inflateInit2: 0 for zlib, 16 for gzip, 32 to detect
+  // either by the first input byte.
+  int Init(int gzip_header) {
+    state_ = new(std::nothrow) inflate_state;
+    COND_RETURN(state_ == 0, Z_MEM_ERROR);
+
+    isal_inflate_init(state_);
+    detect_ = gzip_header == 32;
+    state_->crc_flag = gzip_header == 16 ? ISAL_GZIP : ISAL_ZLIB;
+    return Z_OK;
+  }
+
+
+  // Decode as much of data as possible, growing out when igzip still holds
+  // decoded bytes, since they would be lost for the caller otherwise.
+  int Write(char *data, size_t &dataLength, Blob &out) {
+    if (detect_ && dataLength > 0) {
+      // zlib header starts with CM = 8 in low nibble, gzip with 0x1f.
+      state_->crc_flag = (unsigned char)data[0] == 0x1f ? ISAL_GZIP :
+          ISAL_ZLIB;
+      detect_ = false;
+    }
+
+    unsigned int slice = SliceLength(dataLength);
+    size_t rest = dataLength - slice;
+    state_->next_in = reinterpret_cast<uint8_t*>(data);
+    state_->avail_in = slice;
+    for (;;) {
+      state_->next_out = out.data() + out.length();
+      size_t initAvail = state_->avail_out = SliceLength(out.avail());
+
+      int ret = isal_inflate(state_);
+      out.IncreaseLengthBy(initAvail - state_->avail_out);
+      dataLength = rest + state_->avail_in;
+      COND_RETURN(ret == ISAL_NEED_DICT, Z_NEED_DICT);
+      COND_RETURN(ret < 0, Z_DATA_ERROR);
+
+      if (state_->block_state == ISAL_BLOCK_FINISH) {
+        return Z_STREAM_END;
+      }
+      if (state_->avail_out > 0) {
+        return Z_OK;
+      }
+      if (out.avail() == 0) {
+        COND_RETURN(!out.GrowBy(out.capacity() + 4096), Z_MEM_ERROR);
+      }
+    }
+  }
+
+
+  void Destroy() {
+    delete state_;
+    state_ = 0;
+  }
+
+ private:
+  inflate_state *state_;
+  bool detect_;
+
+ private:
+  IsalInflate(IsalInflate&);
+  IsalInflate(const IsalInflate&);
+  IsalInflate& operator=(IsalInflate&);
+  IsalInflate& operator=(const IsalInflate&);
+};
+
+#endif
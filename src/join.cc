@@ -0,0 +1,417 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <node.h>
+#include <node_buffer.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <new>
+
+#include "utils.h"
+#include "buffer.h"
+
+using namespace v8;
+using namespace node;
+
+// joinGzip(buffers, callback): joins gzip members of all buffers into a
+// single-member gzip stream without recompressing, calling callback(exc,
+// output).  Deflate data of every member is copied as is, except that the
+// last-block bit is cleared and the stream is padded to a byte boundary
+// with empty blocks; CRC and ISIZE are combined from member trailers.
+// Members are inflated into a discarded window only to find block
+// boundaries, as zlib's gzjoin does.
+class GzipJoin {
+ private:
+  enum {
+    ScratchSize = 64 << 10,
+    MaxBuffers = 65536,
+
+    // Header flags.
+    FlagHeaderCrc = 2,
+    FlagExtra = 4,
+    FlagName = 8,
+    FlagComment = 16
+  };
+
+  struct Job {
+    Job(Local<Function> callback, int count)
+      : callback(Persistent<Function>::New(callback)), count(count),
+      buffers(new(std::nothrow) Persistent<Value>[count]),
+      data(new(std::nothrow) const Bytef*[count]),
+      lengths(new(std::nothrow) size_t[count]),
+      status(Z_OK), crc(crc32(0, Z_NULL, 0)), total(0), members(0)
+    {}
+
+    ~Job() {
+      callback.Dispose();
+      if (buffers != 0) {
+        for (int i = 0; i < count; ++i) {
+          buffers[i].Dispose();
+        }
+      }
+      delete[] buffers;
+      delete[] data;
+      delete[] lengths;
+    }
+
+    bool allocated() const {
+      return buffers != 0 && data != 0 && lengths != 0;
+    }
+
+    Persistent<Function> callback;
+
+    int count;
+    Persistent<Value> *buffers;
+    const Bytef **data;
+    size_t *lengths;
+
+    int status;
+    uLong crc;
+    uLong total;
+    size_t members;
+    ScopedBlob out;
+  };
+
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+
+    NODE_SET_METHOD(target, "joinGzip", JoinGzip);
+  }
+
+ private:
+  static Handle<Value> JoinGzip(const Arguments &args) {
+    HandleScope scope;
+
+    if (args.Length() < 2 || !args[0]->IsArray()) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Input must be an array of Buffers"));
+      return ThrowException(exception);
+    }
+    if (!args[1]->IsFunction()) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Callback must be a function"));
+      return ThrowException(exception);
+    }
+
+    Local<Array> input = Local<Array>::Cast(args[0]);
+    if (input->Length() > MaxBuffers) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Too many input buffers"));
+      return ThrowException(exception);
+    }
+    for (uint32_t i = 0; i < input->Length(); ++i) {
+      if (!Buffer::HasInstance(input->Get(i))) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("Input must be an array of Buffers"));
+        return ThrowException(exception);
+      }
+    }
+
+    Job *job = new(std::nothrow) Job(Local<Function>::Cast(args[1]),
+        input->Length());
+    if (job == 0 || !job->allocated()) {
+      delete job;
+      V8::LowMemoryNotification();
+      return ThrowException(Exception::Error(
+            String::New("Insufficient space")));
+    }
+    for (int i = 0; i < job->count; ++i) {
+      Local<Object> buffer = input->Get(i)->ToObject();
+      job->buffers[i] = Persistent<Value>::New(buffer);
+      job->data[i] = reinterpret_cast<const Bytef*>(Buffer::Data(buffer));
+      job->lengths[i] = Buffer::Length(buffer);
+    }
+
+    eio_custom(DoJoin, EIO_PRI_DEFAULT, DoHandleJoin, job);
+    ev_ref(EV_DEFAULT_UC);
+    return Undefined();
+  }
+
+
+  // Executed in worker thread.
+  static int DoJoin(eio_req *req) {
+    Job *job = reinterpret_cast<Job*>(req->data);
+
+    static const char header[10] = {
+      '\x1f', '\x8b', Z_DEFLATED, 0, 0, 0, 0, 0, 0, 3
+    };
+    if (!Append(job->out, header, sizeof(header))) {
+      job->status = Z_MEM_ERROR;
+      return 0;
+    }
+
+    Bytef *scratch = static_cast<Bytef*>(malloc(ScratchSize));
+    if (scratch == 0) {
+      job->status = Z_MEM_ERROR;
+      return 0;
+    }
+    for (int i = 0; i < job->count && job->status == Z_OK; ++i) {
+      size_t offset = 0;
+      while (offset < job->lengths[i] && job->status == Z_OK) {
+        job->status = CopyMember(job, i, offset, scratch);
+      }
+    }
+    free(scratch);
+    if (job->status != Z_OK) {
+      return 0;
+    }
+
+    // Empty final block stands in when there was no member at all.
+    static const char empty[2] = { 3, 0 };
+    char trailer[8];
+    PutLE32(trailer, job->crc);
+    PutLE32(trailer + 4, job->total);
+    if ((job->members == 0 && !Append(job->out, empty, sizeof(empty))) ||
+        !Append(job->out, trailer, sizeof(trailer))) {
+      job->status = Z_MEM_ERROR;
+    }
+    return 0;
+  }
+
+
+  // Copies member at offset of buffer index, advancing offset past it.
+  static int CopyMember(Job *job, int index, size_t &offset, Bytef *scratch) {
+    const Bytef *data = job->data[index];
+    size_t length = job->lengths[index];
+
+    size_t start = offset;
+    COND_RETURN(!SkipHeader(data, length, start), Z_DATA_ERROR);
+    COND_RETURN(start >= length, Z_DATA_ERROR);
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    COND_RETURN(inflateInit2(&stream, -MAX_WBITS) != Z_OK, Z_MEM_ERROR);
+
+    // Remember where the header of the last block is, to clear its bit.
+    size_t lastAt = start;
+    int lastMask = data[start] & 1;
+    uLong size = 0;
+
+    // Inflate stops at every block boundary; the one after the last block
+    // still has the unused bit count of the final byte, lost once inflate
+    // moves on to the end of stream.
+    stream.next_in = const_cast<Bytef*>(data + start);
+    int ret = Z_OK;
+    bool done = false;
+    const size_t chunk = 1 << 30;
+    while (!done) {
+      if (stream.avail_in == 0) {
+        size_t left = length - (stream.next_in - data);
+        if (left == 0) {
+          ret = Z_DATA_ERROR;
+          break;
+        }
+        stream.avail_in = left < chunk ? left : chunk;
+      }
+      stream.next_out = scratch;
+      stream.avail_out = ScratchSize;
+      ret = inflate(&stream, Z_BLOCK);
+      if (ret != Z_OK) {
+        break;
+      }
+      size += ScratchSize - stream.avail_out;
+
+      if ((stream.data_type & 128) == 0) {
+        continue;
+      }
+      if ((stream.data_type & 64) != 0) {
+        done = true;
+        break;
+      }
+      int pos = stream.data_type & 7;
+      size_t used = stream.next_in - data;
+      if (pos != 0 && (data[used - 1] & (0x100 >> pos)) != 0) {
+        lastAt = used - 1;
+        lastMask = 0x100 >> pos;
+      } else if (pos == 0 && used < length && (data[used] & 1) != 0) {
+        lastAt = used;
+        lastMask = 1;
+      }
+    }
+    int pos = stream.data_type & 7;
+    size_t end = stream.next_in - data;
+    inflateEnd(&stream);
+    COND_RETURN(!done, ret == Z_MEM_ERROR ? ret : Z_DATA_ERROR);
+    COND_RETURN(length - end < 8, Z_DATA_ERROR);
+    COND_RETURN(GetLE32(data + end + 4) != (size & 0xffffffffUL),
+        Z_DATA_ERROR);
+
+    offset = end + 8;
+    bool last = IsLast(job, index, offset);
+    COND_RETURN(!AppendDeflate(job->out, data + start, end - start,
+          last ? 0 : lastAt - start, last ? 0 : lastMask, last ? 0 : pos),
+        Z_MEM_ERROR);
+
+    job->crc = crc32_combine(job->crc, GetLE32(data + end), size);
+    job->total += size;
+    ++job->members;
+    return Z_OK;
+  }
+
+
+  // Appends deflate data with last-block bit at lastAt cleared, padding the
+  // final byte having pos unused bits with empty blocks up to a byte
+  // boundary.  Zero mask appends data as is.
+  static bool AppendDeflate(ScopedBlob &out, const Bytef *data, size_t length,
+      size_t lastAt, int lastMask, int pos) {
+    size_t base = out.length();
+    COND_RETURN(!Append(out, data, length), false);
+    if (lastMask == 0) {
+      return true;
+    }
+
+    Bytef *copy = reinterpret_cast<Bytef*>(out.data() + base);
+    copy[lastAt] &= ~lastMask;
+    if (pos == 0) {
+      return true;
+    }
+
+    // Empty stored block for odd number of bits left, fixed blocks
+    // otherwise, as in zlib's gzjoin.
+    Bytef last = copy[length - 1] & ((0x100 >> pos) - 1);
+    out.ResetLength();
+    out.IncreaseLengthBy(base + length - 1);
+    Bytef tail[7];
+    int n = 0;
+    if (pos & 1) {
+      tail[n++] = last;
+      if (pos == 1) {
+        tail[n++] = 0;
+      }
+      tail[n++] = 0;
+      tail[n++] = 0;
+      tail[n++] = 0xff;
+      tail[n++] = 0xff;
+    } else {
+      if (pos == 6) {
+        tail[n++] = last | 8;
+        last = 0;
+      }
+      if (pos >= 4) {
+        tail[n++] = last | 0x20;
+        last = 0;
+      }
+      tail[n++] = last | 0x80;
+      tail[n++] = 0;
+    }
+    return Append(out, tail, n);
+  }
+
+
+  // Whether nothing follows offset of buffer index in this and next buffers.
+  static bool IsLast(Job *job, int index, size_t offset) {
+    COND_RETURN(offset < job->lengths[index], false);
+    for (int i = index + 1; i < job->count; ++i) {
+      COND_RETURN(job->lengths[i] > 0, false);
+    }
+    return true;
+  }
+
+
+  // Moves offset past gzip member header.
+  static bool SkipHeader(const Bytef *data, size_t length, size_t &offset) {
+    COND_RETURN(length - offset < 10, false);
+    const Bytef *header = data + offset;
+    COND_RETURN(header[0] != 0x1f || header[1] != 0x8b ||
+        header[2] != Z_DEFLATED, false);
+    int flags = header[3];
+    offset += 10;
+
+    if (flags & FlagExtra) {
+      COND_RETURN(length - offset < 2, false);
+      size_t extra = data[offset] | (data[offset + 1] << 8);
+      COND_RETURN(length - offset - 2 < extra, false);
+      offset += 2 + extra;
+    }
+    if (flags & FlagName) {
+      COND_RETURN(!SkipString(data, length, offset), false);
+    }
+    if (flags & FlagComment) {
+      COND_RETURN(!SkipString(data, length, offset), false);
+    }
+    if (flags & FlagHeaderCrc) {
+      COND_RETURN(length - offset < 2, false);
+      offset += 2;
+    }
+    return true;
+  }
+
+
+  static bool SkipString(const Bytef *data, size_t length, size_t &offset) {
+    const void *zero = memchr(data + offset, 0, length - offset);
+    COND_RETURN(zero == 0, false);
+    offset = static_cast<const Bytef*>(zero) - data + 1;
+    return true;
+  }
+
+
+  static bool Append(ScopedBlob &out, const void *data, size_t length) {
+    if (out.avail() < length) {
+      size_t grow = out.capacity() > length ? out.capacity() : length;
+      COND_RETURN(!out.GrowBy(grow), false);
+    }
+    memcpy(out.data() + out.length(), data, length);
+    out.IncreaseLengthBy(length);
+    return true;
+  }
+
+
+  static uLong GetLE32(const Bytef *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uLong)p[3] << 24);
+  }
+
+
+  static void PutLE32(char *p, uLong value) {
+    for (int i = 0; i < 4; ++i) {
+      p[i] = (char)(value >> (8 * i));
+    }
+  }
+
+
+  // Executed in V8 thread.
+  static int DoHandleJoin(eio_req *req) {
+    HandleScope scope;
+    Job *job = reinterpret_cast<Job*>(req->data);
+
+    Local<Value> argv[2];
+    argv[0] = GzipUtils::GetException(job->status);
+    argv[1] = Local<Value>::New(Undefined());
+    if (job->status == Z_OK) {
+      size_t length = job->out.length();
+      argv[1] = MakeBuffer(job->out.Release(), length, FreeMalloced, 0);
+    }
+
+    TryCatch try_catch;
+    job->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+    if (try_catch.HasCaught()) {
+      FatalException(try_catch);
+    }
+    delete job;
+
+    ev_unref(EV_DEFAULT_UC);
+    return 0;
+  }
+
+};
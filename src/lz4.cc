@@ -0,0 +1,343 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <node.h>
+#include <node_events.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <lz4frame.h>
+
+#include "utils.h"
+#include "zlib.h"
+
+using namespace v8;
+using namespace node;
+
+// LZ4 frame API reports errors as size_t codes, which are mapped to small
+// negative statuses here, as other libraries do.
+class Lz4Utils {
+ public:
+  typedef ScopedBlob Blob;
+
+  enum Status {
+    Ok = 0,
+    StreamEnd = 1,
+    SequenceError = -1,
+    MemError = -2,
+    DataError = -3,
+    UnexpectedEof = -4,
+    LibraryError = -5
+  };
+
+ public:
+  static int StatusOk() {
+    return Ok;
+  }
+
+
+  static int StatusSequenceError() {
+    return SequenceError;
+  }
+
+
+  static int StatusMemoryError() {
+    return MemError;
+  }
+
+
+  static int StatusEndOfStream() {
+    return StreamEnd;
+  }
+
+ public:
+  static bool IsError(int lz4Status) {
+    return lz4Status < 0;
+  }
+
+
+  static Local<Value> GetException(int lz4Status) {
+    if (!IsError(lz4Status)) {
+      return Local<Value>::New(Undefined());
+    } else {
+      switch (lz4Status) {
+        case SequenceError:
+          return Exception::Error(String::New(SequenceErrorMessage));
+        case MemError:
+          return Exception::Error(String::New(MemErrorMessage));
+        case DataError:
+          return Exception::Error(String::New(DataErrorMessage));
+        case UnexpectedEof:
+          return Exception::Error(String::New(UnexpectedEofMessage));
+        case LibraryError:
+          return Exception::Error(String::New(LibraryErrorMessage));
+
+        default:
+          return Exception::Error(String::New("Unknown error"));
+      }
+    }
+  }
+
+ private:
+  static const char SequenceErrorMessage[];
+  static const char MemErrorMessage[];
+  static const char DataErrorMessage[];
+  static const char UnexpectedEofMessage[];
+  static const char LibraryErrorMessage[];
+};
+const char Lz4Utils::SequenceErrorMessage[] = "Call sequence error.";
+const char Lz4Utils::MemErrorMessage[] = "Out of memory.";
+const char Lz4Utils::DataErrorMessage[] = "Input data corrupted.";
+const char Lz4Utils::UnexpectedEofMessage[] = "Unexpected end of input.";
+const char Lz4Utils::LibraryErrorMessage[] = "LZ4 library error.";
+
+
+class Lz4Impl {
+#ifdef NEED_PUBLIC_FRIEND
+ public:
+#endif
+  friend class ZipLib<Lz4Impl>;
+  friend class Codec<Lz4Impl>;
+
+  typedef Lz4Utils Utils;
+  typedef Lz4Utils::Blob Blob;
+
+ private:
+  static const char Name[];
+
+ private:
+  Handle<Value> Init(const Arguments &args) {
+    HandleScope scope;
+
+    int level = 0;
+    want_buffer_ = false;
+    ctx_ = 0;
+
+    if (args.Length() > 0 && !args[0]->IsUndefined()) {
+      if (!args[0]->IsInt32()) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("level must be an integer"));
+        return ThrowException(exception);
+      }
+      level = args[0]->Int32Value();
+    }
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+      want_buffer_ = args[1]->BooleanValue() ? true : false;
+    }
+
+    int ret = InitStream(level);
+    if (Utils::IsError(ret)) {
+      return ThrowException(Utils::GetException(ret));
+    }
+    return Undefined();
+  }
+
+
+  int Init(int level) {
+    want_buffer_ = true;
+    return InitStream(level < 0 ? 0 : level);
+  }
+
+
+  // Levels below 3 use fast compressor, higher levels use LZ4 HC.
+  int InitStream(int level) {
+    started_ = false;
+    done_ = false;
+    if (LZ4F_isError(LZ4F_createCompressionContext(&ctx_, LZ4F_VERSION))) {
+      ctx_ = 0;
+      return Utils::MemError;
+    }
+
+    memset(&prefs_, 0, sizeof(prefs_));
+    prefs_.frameInfo.blockSizeID = LZ4F_max64KB;
+    prefs_.frameInfo.blockMode = LZ4F_blockLinked;
+    prefs_.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+    prefs_.compressionLevel = level;
+    return Utils::Ok;
+  }
+
+
+  int Write(char *data, size_t &dataLength, Blob &out, bool flush) {
+    out.setUseBufferOut(want_buffer_);
+
+    int ret = Begin(out);
+    COND_RETURN(Utils::IsError(ret), ret);
+
+    // Frame API needs room for worst case of input and buffered block.
+    size_t bound = LZ4F_compressBound(dataLength, &prefs_);
+    if (out.avail() < bound) {
+      COND_RETURN(!out.GrowBy(bound - out.avail()), Utils::MemError);
+    }
+
+    size_t n = LZ4F_compressUpdate(ctx_, out.data() + out.length(),
+        out.avail(), data, dataLength, NULL);
+    COND_RETURN(LZ4F_isError(n), Utils::LibraryError);
+
+    out.IncreaseLengthBy(n);
+    dataLength = 0;
+    return Utils::Ok;
+  }
+
+
+  int Finish(Blob &out) {
+    out.setUseBufferOut(want_buffer_);
+    COND_RETURN(done_, Utils::StreamEnd);
+
+    int ret = Begin(out);
+    COND_RETURN(Utils::IsError(ret), ret);
+
+    size_t bound = LZ4F_compressBound(0, &prefs_);
+    if (out.avail() < bound) {
+      COND_RETURN(!out.GrowBy(bound - out.avail()), Utils::MemError);
+    }
+
+    size_t n = LZ4F_compressEnd(ctx_, out.data() + out.length(),
+        out.avail(), NULL);
+    COND_RETURN(LZ4F_isError(n), Utils::LibraryError);
+
+    out.IncreaseLengthBy(n);
+    done_ = true;
+    return Utils::StreamEnd;
+  }
+
+
+  void Destroy() {
+    if (ctx_) {
+      LZ4F_freeCompressionContext(ctx_);
+      ctx_ = 0;
+    }
+  }
+
+ private:
+  // Frame header is emitted lazily, so empty stream still produces a frame.
+  int Begin(Blob &out) {
+    if (started_) {
+      return Utils::Ok;
+    }
+    if (out.avail() < LZ4F_HEADER_SIZE_MAX) {
+      COND_RETURN(!out.GrowBy(LZ4F_HEADER_SIZE_MAX), Utils::MemError);
+    }
+
+    size_t n = LZ4F_compressBegin(ctx_, out.data() + out.length(),
+        out.avail(), &prefs_);
+    COND_RETURN(LZ4F_isError(n), Utils::LibraryError);
+
+    out.IncreaseLengthBy(n);
+    started_ = true;
+    return Utils::Ok;
+  }
+
+ private:
+  bool want_buffer_;
+  bool started_;
+  bool done_;
+  LZ4F_cctx *ctx_;
+  LZ4F_preferences_t prefs_;
+};
+const char Lz4Impl::Name[] = "Lz4";
+typedef ZipLib<Lz4Impl> Lz4;
+
+
+class Unlz4Impl {
+#ifdef NEED_PUBLIC_FRIEND
+ public:
+#endif
+  friend class ZipLib<Unlz4Impl>;
+  friend class Codec<Unlz4Impl>;
+
+  typedef Lz4Utils Utils;
+  typedef Lz4Utils::Blob Blob;
+
+ private:
+  static const char Name[];
+
+ private:
+  Handle<Value> Init(const Arguments &args) {
+    HandleScope scope;
+
+    want_buffer_ = false;
+    ctx_ = 0;
+    if (args.Length() > 0 && !args[0]->IsUndefined()) {
+      want_buffer_ = args[0]->BooleanValue() ? true : false;
+    }
+
+    int ret = InitStream();
+    if (Utils::IsError(ret)) {
+      return ThrowException(Utils::GetException(ret));
+    }
+    return Undefined();
+  }
+
+
+  int Init(int level) {
+    want_buffer_ = true;
+    return InitStream();
+  }
+
+
+  int InitStream() {
+    pending_ = false;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&ctx_, LZ4F_VERSION))) {
+      ctx_ = 0;
+      return Utils::MemError;
+    }
+    return Utils::Ok;
+  }
+
+
+  int Write(char *data, size_t &dataLength, Blob &out, bool flush) {
+    out.setUseBufferOut(want_buffer_);
+
+    size_t srcSize = dataLength;
+    size_t dstSize = out.avail();
+    size_t hint = LZ4F_decompress(ctx_, out.data() + out.length(), &dstSize,
+        data, &srcSize, NULL);
+    COND_RETURN(LZ4F_isError(hint), Utils::DataError);
+
+    out.IncreaseLengthBy(dstSize);
+    dataLength -= srcSize;
+    pending_ = hint != 0;
+    return pending_ ? Utils::Ok : Utils::StreamEnd;
+  }
+
+
+  // Reaching Finish means frame end wasn't seen in input.
+  int Finish(Blob &out) {
+    out.setUseBufferOut(want_buffer_);
+    return pending_ ? Utils::UnexpectedEof : Utils::StreamEnd;
+  }
+
+
+  void Destroy() {
+    if (ctx_) {
+      LZ4F_freeDecompressionContext(ctx_);
+      ctx_ = 0;
+    }
+  }
+
+ private:
+  bool want_buffer_;
+  bool pending_;
+  LZ4F_dctx *ctx_;
+};
+const char Unlz4Impl::Name[] = "Unlz4";
+typedef ZipLib<Unlz4Impl> Unlz4;
@@ -0,0 +1,875 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <node.h>
+#include <node_buffer.h>
+#include <zlib.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "utils.h"
+#include "buffer.h"
+#include "slab.h"
+#include "stats.h"
+
+using namespace v8;
+using namespace node;
+
+// Reads integer option name into value, leaves value intact when option is
+// not set.  Returns exception if option is set but not in [min, max].
+static Local<Value> GetMessageOption(Local<Object> options, const char *name,
+    int min, int max, int &value) {
+  Local<Value> option = options->Get(String::NewSymbol(name));
+  if (option->IsUndefined()) {
+    return Local<Value>();
+  }
+  if (!option->IsInt32() || option->Int32Value() < min ||
+      option->Int32Value() > max) {
+    char message[64];
+    snprintf(message, sizeof(message), "%s is out of range", name);
+    return Exception::RangeError(String::New(message));
+  }
+  value = option->Int32Value();
+  return Local<Value>();
+}
+
+
+// Raw deflate of whole messages as of RFC 7692: every message ends with
+// a sync flush and the trailing empty stored block 00 00 ff ff is
+// stripped.  Without context takeover the window is reset between
+// messages.
+class MessageDeflater {
+ public:
+  typedef GzipUtils Utils;
+  typedef GzipUtils::Blob Blob;
+
+  static const char Name[];
+
+ public:
+  MessageDeflater()
+    : allocated_(false), context_takeover_(true)
+  {}
+
+  ~MessageDeflater() {
+    Destroy();
+  }
+
+
+  // Returns exception for invalid options, empty handle otherwise.
+  Local<Value> Init(Local<Object> options) {
+    int level = Z_DEFAULT_COMPRESSION;
+    // zlib raw deflate does not support 256 byte window.
+    int windowBits = MAX_WBITS;
+    int memLevel = 8;
+    Local<Value> exception;
+
+    exception = GetMessageOption(options, "level", -1, 9, level);
+    COND_RETURN(!exception.IsEmpty(), exception);
+    exception = GetMessageOption(options, "windowBits", 9, MAX_WBITS,
+        windowBits);
+    COND_RETURN(!exception.IsEmpty(), exception);
+    exception = GetMessageOption(options, "memLevel", 1, MAX_MEM_LEVEL,
+        memLevel);
+    COND_RETURN(!exception.IsEmpty(), exception);
+    Local<Value> takeover =
+        options->Get(String::NewSymbol("contextTakeover"));
+    context_takeover_ = takeover->IsUndefined() || takeover->BooleanValue();
+
+    stream_.zalloc = Slab::Alloc;
+    stream_.zfree = Slab::Free;
+    stream_.opaque = Z_NULL;
+    int ret = deflateInit2(&stream_, level, Z_DEFLATED, -windowBits,
+        memLevel, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) {
+      return Utils::GetException(ret);
+    }
+    allocated_ = true;
+    return Local<Value>();
+  }
+
+
+  // Appends compressed message to out.
+  int Process(const char *data, size_t length, Blob &out) {
+    COND_RETURN(!allocated_, Z_STREAM_ERROR);
+
+    size_t begin = out.length();
+    stream_.next_in = (Bytef*)data;
+    stream_.avail_in = length;
+    for (;;) {
+      if (out.avail() < MinAvail) {
+        COND_RETURN(!out.GrowBy(out.capacity() + MinAvail), Z_MEM_ERROR);
+      }
+      stream_.next_out = out.data() + out.length();
+      stream_.avail_out = out.avail();
+
+      int ret = deflate(&stream_, Z_SYNC_FLUSH);
+      out.IncreaseLengthBy(out.avail() - stream_.avail_out);
+      // Z_BUF_ERROR only means there was nothing left to flush.
+      COND_RETURN(ret != Z_OK && ret != Z_BUF_ERROR, ret);
+
+      if (stream_.avail_in == 0 && stream_.avail_out != 0) {
+        break;
+      }
+    }
+
+    static const Bytef Tail[4] = { 0, 0, 0xff, 0xff };
+    if (out.length() - begin >= sizeof(Tail) &&
+        memcmp(out.data() + out.length() - sizeof(Tail), Tail,
+          sizeof(Tail)) == 0) {
+      out.DecreaseLengthBy(sizeof(Tail));
+    }
+    // Empty message with nothing left to flush is sent as an empty stored
+    // block without its tail, a single 0x00 (RFC 7692 7.2.3.6).
+    if (out.length() == begin) {
+      out.data()[out.length()] = 0;
+      out.IncreaseLengthBy(1);
+    }
+
+    if (!context_takeover_) {
+      return deflateReset(&stream_);
+    }
+    return Z_OK;
+  }
+
+
+  void Destroy() {
+    if (allocated_) {
+      deflateEnd(&stream_);
+      allocated_ = false;
+    }
+  }
+
+ private:
+  enum { MinAvail = 64 };
+
+ private:
+  z_stream stream_;
+  bool allocated_;
+  bool context_takeover_;
+
+ private:
+  MessageDeflater(MessageDeflater&);
+  MessageDeflater(const MessageDeflater&);
+  MessageDeflater& operator=(MessageDeflater&);
+  MessageDeflater& operator=(const MessageDeflater&);
+};
+const char MessageDeflater::Name[] = "MessageDeflate";
+
+
+// Inverse of MessageDeflater: 00 00 ff ff is appended to every message
+// before inflating it.  A message ending with a final block resets the
+// stream, as does every message without context takeover.
+class MessageInflater {
+ public:
+  typedef GzipUtils Utils;
+  typedef GzipUtils::Blob Blob;
+
+  static const char Name[];
+
+ public:
+  MessageInflater()
+    : allocated_(false), context_takeover_(true)
+  {}
+
+  ~MessageInflater() {
+    Destroy();
+  }
+
+
+  // Returns exception for invalid options, empty handle otherwise.
+  Local<Value> Init(Local<Object> options) {
+    int windowBits = MAX_WBITS;
+    Local<Value> exception;
+
+    exception = GetMessageOption(options, "windowBits", 8, MAX_WBITS,
+        windowBits);
+    COND_RETURN(!exception.IsEmpty(), exception);
+    Local<Value> takeover =
+        options->Get(String::NewSymbol("contextTakeover"));
+    context_takeover_ = takeover->IsUndefined() || takeover->BooleanValue();
+
+    stream_.zalloc = Slab::Alloc;
+    stream_.zfree = Slab::Free;
+    stream_.opaque = Z_NULL;
+    stream_.next_in = Z_NULL;
+    stream_.avail_in = 0;
+    int ret = inflateInit2(&stream_, -windowBits);
+    if (ret != Z_OK) {
+      return Utils::GetException(ret);
+    }
+    allocated_ = true;
+    return Local<Value>();
+  }
+
+
+  // Appends decompressed message to out.
+  int Process(const char *data, size_t length, Blob &out) {
+    COND_RETURN(!allocated_, Z_STREAM_ERROR);
+
+    static const Bytef Tail[4] = { 0, 0, 0xff, 0xff };
+    bool ended = false;
+    int ret = Feed((const Bytef*)data, length, out, ended);
+    if (ret == Z_OK && !ended) {
+      ret = Feed(Tail, sizeof(Tail), out, ended);
+    }
+    COND_RETURN(ret != Z_OK, ret);
+
+    if (!ended && !context_takeover_) {
+      return inflateReset(&stream_);
+    }
+    return Z_OK;
+  }
+
+
+  void Destroy() {
+    if (allocated_) {
+      inflateEnd(&stream_);
+      allocated_ = false;
+    }
+  }
+
+ private:
+  // Inflates all of input, stream is reset and the rest of input ignored
+  // after the final block.
+  int Feed(const Bytef *data, size_t length, Blob &out, bool &ended) {
+    stream_.next_in = (Bytef*)data;
+    stream_.avail_in = length;
+    for (;;) {
+      if (out.avail() < MinAvail) {
+        COND_RETURN(!out.GrowBy(out.capacity() + MinAvail), Z_MEM_ERROR);
+      }
+      stream_.next_out = out.data() + out.length();
+      stream_.avail_out = out.avail();
+
+      int ret = inflate(&stream_, Z_SYNC_FLUSH);
+      out.IncreaseLengthBy(out.avail() - stream_.avail_out);
+      if (ret == Z_STREAM_END) {
+        ended = true;
+        return inflateReset(&stream_);
+      }
+      if (ret == Z_BUF_ERROR && stream_.avail_in == 0) {
+        break;
+      }
+      COND_RETURN(ret != Z_OK, ret);
+
+      if (stream_.avail_in == 0 && stream_.avail_out != 0) {
+        break;
+      }
+    }
+    return Z_OK;
+  }
+
+ private:
+  enum { MinAvail = 256 };
+
+ private:
+  z_stream stream_;
+  bool allocated_;
+  bool context_takeover_;
+
+ private:
+  MessageInflater(MessageInflater&);
+  MessageInflater(const MessageInflater&);
+  MessageInflater& operator=(MessageInflater&);
+  MessageInflater& operator=(const MessageInflater&);
+};
+const char MessageInflater::Name[] = "MessageInflate";
+
+
+// MessageDeflate(options) and MessageInflate(options): websocket
+// permessage-deflate codecs, one call per message.  options are level,
+// windowBits, memLevel, contextTakeover and syncThreshold.
+//
+// write(buffer, callback) passes the message's output Buffer to callback,
+// writeMessages(buffers, callback) processes queued frames in one thread
+// pool job and passes an array of Buffers sharing one allocation.  Writes
+// queued behind a running job are merged into the next one the same way,
+// each callback still gets its own output.  Messages
+// up to syncThreshold bytes written while no request is pending are
+// processed right away on V8 thread, their callbacks are still deferred
+// to nextTick.  writeSync(buffer) returns output directly.  The output
+// area is kept across messages, so steady state does not allocate besides
+// the result Buffer.
+template <class Engine>
+class MessageCodec : ObjectWrap {
+ private:
+  typedef MessageCodec<Engine> Self;
+  typedef typename Engine::Utils Utils;
+  typedef typename Engine::Blob Blob;
+
+  enum {
+    DefaultSyncThreshold = 512,
+    MaxMessage = 1 << 30
+  };
+
+  struct Item {
+    const char *data;
+    size_t length;
+
+    // Output of the message ends here, starts where previous ends or at
+    // Request::begin.
+    size_t end;
+  };
+
+  struct Request {
+    enum Kind {
+      RWrite,
+      RClose
+    };
+
+    Request(Self *self, Kind kind, Local<Function> callback)
+      : self(self), kind(kind), batch(false), items(&item), count(0),
+        begin(0), status(Z_OK), queued_at(0), next(0), last(this)
+    {
+      if (!callback.IsEmpty()) {
+        this->callback = Persistent<Function>::New(callback);
+      }
+    }
+
+    ~Request() {
+      input.Dispose();
+      output.Dispose();
+      callback.Dispose();
+      if (items != &item) {
+        delete[] items;
+      }
+    }
+
+    Self *self;
+    Kind kind;
+
+    // Buffer, or private copy of buffers array for a batch.
+    Persistent<Value> input;
+    bool batch;
+    Item item;
+    Item *items;
+    int count;
+    // Output of the request starts here in the output area.
+    size_t begin;
+
+    int status;
+    uint64_t queued_at;
+
+    // Result of request processed on V8 thread.
+    Persistent<Value> output;
+
+    Persistent<Function> callback;
+    Request *next;
+    // Last request of the job this one starts, see Schedule().
+    Request *last;
+  };
+
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    constructor_ = Persistent<FunctionTemplate>::New(
+        FunctionTemplate::New(New));
+    constructor_->InstanceTemplate()->SetInternalFieldCount(1);
+
+    Local<Object> globalObj = Context::GetCurrent()->Global();
+    process_ = Persistent<Object>::New(Local<Object>::Cast(
+        globalObj->Get(String::New("process"))));
+    next_tick_ = Persistent<Function>::New(Local<Function>::Cast(
+        process_->Get(String::New("nextTick"))));
+    deliver_ = Persistent<Function>::New(
+        FunctionTemplate::New(DeliverReady)->GetFunction());
+
+    NODE_SET_PROTOTYPE_METHOD(constructor_, "write", Write);
+    NODE_SET_PROTOTYPE_METHOD(constructor_, "writeMessages", WriteMessages);
+    NODE_SET_PROTOTYPE_METHOD(constructor_, "writeSync", WriteSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_, "close", Close);
+    NODE_SET_PROTOTYPE_METHOD(constructor_, "destroy", Close);
+
+    NODE_SET_METHOD(constructor_, "createInstance_", Create);
+
+    target->Set(String::NewSymbol(Engine::Name),
+        constructor_->GetFunction());
+    StatsRegistry::Register(Engine::Name, &stats_);
+  }
+
+ private:
+  static Handle<Value> New(const Arguments &args) {
+    HandleScope scope;
+
+    Local<Object> options = Object::New();
+    if (args.Length() > 0 && !args[0]->IsUndefined()) {
+      if (!args[0]->IsObject()) {
+        return ThrowException(Exception::TypeError(
+              String::New("Options must be an object")));
+      }
+      options = args[0]->ToObject();
+    }
+
+    int threshold = DefaultSyncThreshold;
+    Local<Value> exception = GetMessageOption(options, "syncThreshold", 0,
+        MaxMessage, threshold);
+    if (!exception.IsEmpty()) {
+      return ThrowException(exception);
+    }
+
+    Self *self = new(std::nothrow) Self();
+    if (self == 0) {
+      return ThrowGentleOom();
+    }
+    self->Wrap(args.This());
+    self->sync_threshold_ = threshold;
+
+    exception = self->engine_.Init(options);
+    if (!exception.IsEmpty()) {
+      return ThrowException(exception);
+    }
+    CodecStats::Add(stats_.streams, 1);
+    return args.This();
+  }
+
+
+  static Handle<Value> Create(const Arguments &args) {
+    HandleScope scope;
+
+    Handle<Value> arg = args[0];
+    return constructor_->GetFunction()->NewInstance(1, &arg);
+  }
+
+
+  static Handle<Value> Write(const Arguments &args) {
+    HandleScope scope;
+
+    if (!Buffer::HasInstance(args[0])) {
+      return ThrowException(Exception::TypeError(
+            String::New("Input must be of type Buffer")));
+    }
+    Local<Function> callback;
+    if (!GetCallback(args, 1, callback)) {
+      return ThrowCallbackExpected();
+    }
+
+    Self *self = ObjectWrap::Unwrap<Self>(args.This());
+    Request *request = new(std::nothrow) Request(self, Request::RWrite,
+        callback);
+    if (request == 0) {
+      return ThrowGentleOom();
+    }
+    Local<Object> buffer = args[0]->ToObject();
+    request->input = Persistent<Value>::New(buffer);
+    request->item.data = Buffer::Data(buffer);
+    request->item.length = Buffer::Length(buffer);
+    request->count = 1;
+    return self->PushRequest(request);
+  }
+
+
+  static Handle<Value> WriteMessages(const Arguments &args) {
+    HandleScope scope;
+
+    if (args.Length() < 1 || !args[0]->IsArray()) {
+      return ThrowException(Exception::TypeError(
+            String::New("Input must be an array of Buffers")));
+    }
+    Local<Array> buffers = Local<Array>::Cast(args[0]);
+    // Copy, so that caller may reuse the array.
+    Local<Array> input = Array::New(buffers->Length());
+    for (uint32_t i = 0; i < buffers->Length(); ++i) {
+      Local<Value> buffer = buffers->Get(i);
+      if (!Buffer::HasInstance(buffer)) {
+        return ThrowException(Exception::TypeError(
+              String::New("Input must be an array of Buffers")));
+      }
+      input->Set(i, buffer);
+    }
+    Local<Function> callback;
+    if (!GetCallback(args, 1, callback)) {
+      return ThrowCallbackExpected();
+    }
+
+    Self *self = ObjectWrap::Unwrap<Self>(args.This());
+    Request *request = new(std::nothrow) Request(self, Request::RWrite,
+        callback);
+    if (request == 0) {
+      return ThrowGentleOom();
+    }
+    request->batch = true;
+    request->count = input->Length();
+    if (request->count > 1) {
+      request->items = new(std::nothrow) Item[request->count];
+      if (request->items == 0) {
+        delete request;
+        return ThrowGentleOom();
+      }
+    }
+    for (int i = 0; i < request->count; ++i) {
+      Local<Object> buffer = input->Get(i)->ToObject();
+      request->items[i].data = Buffer::Data(buffer);
+      request->items[i].length = Buffer::Length(buffer);
+    }
+    request->input = Persistent<Value>::New(input);
+    return self->PushRequest(request);
+  }
+
+
+  static Handle<Value> WriteSync(const Arguments &args) {
+    HandleScope scope;
+
+    if (!Buffer::HasInstance(args[0])) {
+      return ThrowException(Exception::TypeError(
+            String::New("Input must be of type Buffer")));
+    }
+    Self *self = ObjectWrap::Unwrap<Self>(args.This());
+    if (self->tail_ != 0 || self->ready_ != 0) {
+      return ThrowException(Exception::Error(
+            String::New("writeSync() called with requests pending")));
+    }
+
+    Local<Object> buffer = args[0]->ToObject();
+    Request request(self, Request::RWrite, Local<Function>());
+    request.item.data = Buffer::Data(buffer);
+    request.item.length = Buffer::Length(buffer);
+    request.count = 1;
+    request.queued_at = NowNs();
+
+    self->Process(&request);
+    Local<Value> output = self->Result(&request, self->TakeArea());
+    if (Utils::IsError(request.status)) {
+      return ThrowException(output);
+    }
+    return scope.Close(output);
+  }
+
+
+  static Handle<Value> Close(const Arguments &args) {
+    HandleScope scope;
+
+    Local<Function> callback;
+    if (!GetCallback(args, 0, callback)) {
+      return ThrowCallbackExpected();
+    }
+
+    Self *self = ObjectWrap::Unwrap<Self>(args.This());
+    Request *request = new(std::nothrow) Request(self, Request::RClose,
+        callback);
+    if (request == 0) {
+      return ThrowGentleOom();
+    }
+    return self->PushRequest(request);
+  }
+
+
+  // Small writes are done in place when nothing is in flight, anything
+  // else is queued behind the current request.
+  // Executed in V8 thread.
+  Handle<Value> PushRequest(Request *request) {
+    request->queued_at = NowNs();
+
+    if (tail_ == 0 && request->kind == Request::RWrite &&
+        InputLength(request) <= (size_t)sync_threshold_) {
+      Process(request);
+      request->output = Persistent<Value>::New(Result(request, TakeArea()));
+      Defer(request);
+      return Undefined();
+    }
+
+    if (tail_ != 0) {
+      tail_->next = request;
+    } else {
+      Schedule(request);
+    }
+    tail_ = request;
+    return Undefined();
+  }
+
+
+  static size_t InputLength(Request *request) {
+    size_t length = 0;
+    for (int i = 0; i < request->count; ++i) {
+      length += request->items[i].length;
+    }
+    return length;
+  }
+
+
+  // Writes queued up to the first other request run as one job.
+  // Executed in V8 thread.
+  void Schedule(Request *request) {
+    Request *last = request;
+    while (last->kind == Request::RWrite && last->next != 0 &&
+        last->next->kind == Request::RWrite) {
+      last = last->next;
+    }
+    request->last = last;
+    eio_custom(DoProcess, EIO_PRI_DEFAULT, DoHandle, request);
+    ev_ref(EV_DEFAULT_UC);
+    Ref();
+  }
+
+
+  // Runs every message of request through the engine, stops at first
+  // error.
+  void Process(Request *request) {
+    uint64_t start = NowNs();
+    CodecStats::Add(stats_.queue_wait_ns, start - request->queued_at);
+    CodecStats::Add(stats_.requests, 1);
+
+    if (request->kind == Request::RClose) {
+      engine_.Destroy();
+      out_.Free();
+      request->status = Utils::StatusOk();
+      return;
+    }
+
+    size_t before = out_.reallocs();
+    request->begin = out_.length();
+    int status = Utils::StatusOk();
+    for (int i = 0; i < request->count; ++i) {
+      Item &item = request->items[i];
+      if (item.length > MaxMessage) {
+        status = Utils::StatusMemoryError();
+      } else {
+        status = engine_.Process(item.data, item.length, out_);
+      }
+      CodecStats::Add(stats_.codec_calls, 1);
+      if (Utils::IsError(status)) {
+        stats_.AddError(status);
+        // Requests merged after this one keep their output in order.
+        out_.DecreaseLengthBy(out_.length() - request->begin);
+        break;
+      }
+      item.end = out_.length();
+      CodecStats::Add(stats_.bytes_in, item.length);
+    }
+    request->status = status;
+
+    CodecStats::Add(stats_.bytes_out, out_.length() - request->begin);
+    CodecStats::Add(stats_.reallocs, out_.reallocs() - before);
+    CodecStats::Add(stats_.write_ns, NowNs() - start);
+  }
+
+
+  // Processes requests of the job in order.  Requests queued meanwhile are
+  // linked after last, which is not followed here.
+  // Executed in worker thread.
+  static int DoProcess(eio_req *req) {
+    Request *request = reinterpret_cast<Request*>(req->data);
+    Request *last = request->last;
+    for (;;) {
+      request->self->Process(request);
+      if (request == last) {
+        break;
+      }
+      request = request->next;
+    }
+    return 0;
+  }
+
+
+  // Executed in V8 thread.
+  static int DoHandle(eio_req *req) {
+    HandleScope scope;
+    Request *request = reinterpret_cast<Request*>(req->data);
+    Self *self = request->self;
+
+    Buffer *area = request->kind == Request::RWrite ? self->TakeArea() : 0;
+    Request *last = request->last;
+    Request *next = last->next;
+    last->next = 0;
+    if (next != 0) {
+      self->Schedule(next);
+    } else {
+      self->tail_ = 0;
+    }
+
+    while (request != 0) {
+      HandleScope scope;
+      Request *following = request->next;
+      CallBack(request, self->Result(request, area));
+      delete request;
+      request = following;
+    }
+    self->Unref();
+
+    ev_unref(EV_DEFAULT_UC);
+    return 0;
+  }
+
+
+  // Copies output of the job into one allocation, which results of its
+  // requests share.  The output area is kept for the next job.
+  Buffer *TakeArea() {
+    size_t length = out_.length();
+    Buffer *slowBuffer = Buffer::New(length);
+    if (length > 0) {
+      memcpy(Buffer::Data(slowBuffer), out_.data(), length);
+    }
+    out_.ResetLength();
+    return slowBuffer;
+  }
+
+
+  // Returns exception, or Buffer or array of Buffers per request kind.
+  Local<Value> Result(Request *request, Buffer *area) {
+    HandleScope scope;
+
+    if (Utils::IsError(request->status)) {
+      return scope.Close(Utils::GetException(request->status));
+    }
+    if (request->kind == Request::RClose) {
+      return scope.Close(Local<Value>::New(Undefined()));
+    }
+
+    if (!request->batch) {
+      return scope.Close(MakeBuffer(area, request->begin,
+            request->items[0].end - request->begin));
+    }
+    Local<Array> result = Array::New(request->count);
+    size_t start = request->begin;
+    for (int i = 0; i < request->count; ++i) {
+      result->Set(i, MakeBuffer(area, start, request->items[i].end - start));
+      start = request->items[i].end;
+    }
+    return scope.Close(result);
+  }
+
+
+  static void CallBack(Request *request, Local<Value> output) {
+    if (request->callback.IsEmpty()) {
+      return;
+    }
+
+    Local<Value> argv[2];
+    if (Utils::IsError(request->status)) {
+      argv[0] = output;
+      argv[1] = Local<Value>::New(Undefined());
+    } else {
+      argv[0] = Local<Value>::New(Undefined());
+      argv[1] = output;
+    }
+
+    TryCatch try_catch;
+    request->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+    if (try_catch.HasCaught()) {
+      FatalException(try_catch);
+    }
+  }
+
+
+  // Callbacks of requests processed in place are delivered in order from
+  // a single nextTick per tick for all objects.
+  // Executed in V8 thread.
+  void Defer(Request *request) {
+    if (ready_tail_ != 0) {
+      ready_tail_->next = request;
+    } else {
+      ready_head_ = request;
+      Handle<Value> arg = deliver_;
+      next_tick_->Call(process_, 1, &arg);
+    }
+    ready_tail_ = request;
+    ++ready_;
+    Ref();
+  }
+
+
+  static Handle<Value> DeliverReady(const Arguments &args) {
+    HandleScope scope;
+
+    // Requests deferred by callbacks go to the next tick.
+    Request *request = ready_head_;
+    ready_head_ = ready_tail_ = 0;
+    while (request != 0) {
+      Request *next = request->next;
+      Self *self = request->self;
+      --self->ready_;
+      CallBack(request, Local<Value>::New(request->output));
+      delete request;
+      self->Unref();
+      request = next;
+    }
+    return Undefined();
+  }
+
+
+  static bool GetCallback(const Arguments &args, int index,
+      Local<Function> &callback) {
+    if (args.Length() > index && !args[index]->IsUndefined()) {
+      if (!args[index]->IsFunction()) {
+        return false;
+      }
+      callback = Local<Function>::Cast(args[index]);
+    }
+    return true;
+  }
+
+
+  static Handle<Value> ThrowCallbackExpected() {
+    Local<Value> exception = Exception::TypeError(
+        String::New("Callback must be a function"));
+    return ThrowException(exception);
+  }
+
+ private:
+  MessageCodec()
+    : ObjectWrap(), sync_threshold_(DefaultSyncThreshold), tail_(0),
+      ready_(0)
+  {}
+
+ private:
+  Engine engine_;
+  Blob out_;
+  int sync_threshold_;
+
+  Request *tail_;
+  int ready_;
+
+  static Request *ready_head_;
+  static Request *ready_tail_;
+
+  static CodecStats stats_;
+  static Persistent<FunctionTemplate> constructor_;
+  static Persistent<Object> process_;
+  static Persistent<Function> next_tick_;
+  static Persistent<Function> deliver_;
+
+ private:
+  MessageCodec(MessageCodec&);
+  MessageCodec(const MessageCodec&);
+  MessageCodec& operator=(MessageCodec&);
+  MessageCodec& operator=(const MessageCodec&);
+};
+template <class Engine>
+typename MessageCodec<Engine>::Request *MessageCodec<Engine>::ready_head_;
+template <class Engine>
+typename MessageCodec<Engine>::Request *MessageCodec<Engine>::ready_tail_;
+template <class Engine>
+CodecStats MessageCodec<Engine>::stats_;
+template <class Engine>
+Persistent<FunctionTemplate> MessageCodec<Engine>::constructor_;
+template <class Engine>
+Persistent<Object> MessageCodec<Engine>::process_;
+template <class Engine>
+Persistent<Function> MessageCodec<Engine>::next_tick_;
+template <class Engine>
+Persistent<Function> MessageCodec<Engine>::deliver_;
+
+typedef MessageCodec<MessageDeflater> MessageDeflate;
+typedef MessageCodec<MessageInflater> MessageInflate;
@@ -0,0 +1,314 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#ifndef NODE_COMPRESS_ONESHOT_H__
+#define NODE_COMPRESS_ONESHOT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+#include <new>
+
+#ifdef WITH_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+#include "utils.h"
+
+// Whole-buffer deflate and inflate, for input available at once.  Built with
+// libdeflate, which is several times faster than streaming zlib in both
+// directions and selects its SSE4.2/AVX2/PCLMUL kernels (CRC32, Adler-32,
+// matchfinder) at run time.  Otherwise falls back to a single zlib call.
+// Output is plain RFC 1950/1951/1952 data, interchangeable with zlib's.
+// Doesn't touch V8.
+class OneShot {
+ public:
+  typedef ScopedOutputBuffer<Bytef> Blob;
+
+  enum Format {
+    Raw,
+    Zlib,
+    Gzip,
+    // Gzip or zlib by magic bytes, decompression only.
+    Auto
+  };
+
+  enum {
+#ifdef WITH_LIBDEFLATE
+    MaxLevel = 12
+#else
+    MaxLevel = 9
+#endif
+  };
+
+ public:
+  // Appends compressed data to out.  Returns Z_STREAM_END on success,
+  // zlib error code otherwise.  Negative level means default (6).
+  static int Compress(Format format, int level, const char *data,
+      size_t length, Blob &out) {
+    COND_RETURN(format == Auto || level > MaxLevel, Z_STREAM_ERROR);
+    if (level < 0) {
+      level = 6;
+    }
+#ifdef WITH_LIBDEFLATE
+    libdeflate_compressor *compressor = Compressor(level);
+    COND_RETURN(compressor == 0, Z_MEM_ERROR);
+
+    size_t bound;
+    switch (format) {
+      case Raw:
+        bound = libdeflate_deflate_compress_bound(compressor, length);
+        break;
+      case Zlib:
+        bound = libdeflate_zlib_compress_bound(compressor, length);
+        break;
+      default:
+        bound = libdeflate_gzip_compress_bound(compressor, length);
+        break;
+    }
+    if (out.avail() < bound) {
+      COND_RETURN(!out.GrowBy(bound - out.avail()), Z_MEM_ERROR);
+    }
+
+    void *dest = out.data() + out.length();
+    size_t n;
+    switch (format) {
+      case Raw:
+        n = libdeflate_deflate_compress(compressor, data, length, dest,
+            out.avail());
+        break;
+      case Zlib:
+        n = libdeflate_zlib_compress(compressor, data, length, dest,
+            out.avail());
+        break;
+      default:
+        n = libdeflate_gzip_compress(compressor, data, length, dest,
+            out.avail());
+        break;
+    }
+    COND_RETURN(n == 0, Z_BUF_ERROR);
+    out.IncreaseLengthBy(n);
+    return Z_STREAM_END;
+#else
+    z_stream *stream = Deflater(format, level);
+    COND_RETURN(stream == 0, Z_MEM_ERROR);
+
+    size_t bound = deflateBound(stream, length);
+    if (out.avail() < bound) {
+      COND_RETURN(!out.GrowBy(bound - out.avail()), Z_MEM_ERROR);
+    }
+
+    // Input and output beyond 4GB go in slices, finishing with the last.
+    stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    int ret;
+    do {
+      unsigned int slice = SliceLength(length);
+      stream->avail_in = slice;
+      stream->next_out = out.data() + out.length();
+      size_t avail = stream->avail_out = SliceLength(out.avail());
+      ret = deflate(stream, slice == length ? Z_FINISH : Z_NO_FLUSH);
+      out.IncreaseLengthBy(avail - stream->avail_out);
+      length -= slice - stream->avail_in;
+    } while (ret == Z_OK && out.avail() > 0);
+    if (ret == Z_OK) {
+      ret = Z_BUF_ERROR;
+    }
+    deflateReset(stream);
+    return ret;
+#endif
+  }
+
+
+  // Appends decompressed data of the first stream in input to out.  Returns
+  // Z_STREAM_END on success, Z_BUF_ERROR for truncated input, zlib error
+  // code otherwise.
+  static int Decompress(Format format, const char *data, size_t length,
+      Blob &out) {
+    if (format == Auto) {
+      format = IsGzip(data, length) ? Gzip : Zlib;
+    }
+#ifdef WITH_LIBDEFLATE
+    libdeflate_decompressor *decompressor = Decompressor();
+    COND_RETURN(decompressor == 0, Z_MEM_ERROR);
+
+    size_t guess = SizeHint(format, data, length);
+    for (;;) {
+      if (out.avail() < guess) {
+        COND_RETURN(!out.GrowBy(guess - out.avail()), Z_MEM_ERROR);
+      }
+
+      void *dest = out.data() + out.length();
+      size_t in = 0, n = 0;
+      libdeflate_result result;
+      switch (format) {
+        case Raw:
+          result = libdeflate_deflate_decompress_ex(decompressor, data,
+              length, dest, out.avail(), &in, &n);
+          break;
+        case Zlib:
+          result = libdeflate_zlib_decompress_ex(decompressor, data,
+              length, dest, out.avail(), &in, &n);
+          break;
+        default:
+          result = libdeflate_gzip_decompress_ex(decompressor, data,
+              length, dest, out.avail(), &in, &n);
+          break;
+      }
+      switch (result) {
+        case LIBDEFLATE_SUCCESS:
+          out.IncreaseLengthBy(n);
+          return Z_STREAM_END;
+        case LIBDEFLATE_INSUFFICIENT_SPACE:
+          guess = out.avail() * 2;
+          break;
+        default:
+          // libdeflate doesn't tell truncated input from corrupted one, let
+          // zlib decide.
+          return Inflate(format, data, length, out);
+      }
+    }
+#else
+    return Inflate(format, data, length, out);
+#endif
+  }
+
+
+  static bool IsGzip(const char *data, size_t length) {
+    return length >= 2 && (unsigned char)data[0] == 0x1f &&
+        (unsigned char)data[1] == 0x8b;
+  }
+
+ private:
+  static int WindowBits(Format format) {
+    switch (format) {
+      case Raw:
+        return -MAX_WBITS;
+      case Zlib:
+        return MAX_WBITS;
+      case Gzip:
+        return MAX_WBITS + 16;
+      default:
+        return MAX_WBITS + 32;
+    }
+  }
+
+
+  static int Inflate(Format format, const char *data, size_t length,
+      Blob &out) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    int ret = inflateInit2(&stream, WindowBits(format));
+    COND_RETURN(ret != Z_OK, ret);
+
+    size_t chunk = SizeHint(format, data, length);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    do {
+      if (out.avail() < chunk && !out.GrowBy(chunk - out.avail())) {
+        ret = Z_MEM_ERROR;
+        break;
+      }
+      // Input beyond 4GB goes in slices.
+      unsigned int slice = SliceLength(length);
+      stream.avail_in = slice;
+      stream.next_out = out.data() + out.length();
+      size_t avail = stream.avail_out = SliceLength(out.avail());
+      ret = inflate(&stream, slice == length ? Z_FINISH : Z_NO_FLUSH);
+      out.IncreaseLengthBy(avail - stream.avail_out);
+      length -= slice - stream.avail_in;
+      chunk = out.capacity();
+      // Z_BUF_ERROR with input left means output is full.
+    } while (ret == Z_OK || (ret == Z_BUF_ERROR && stream.avail_out == 0));
+
+    inflateEnd(&stream);
+    return ret;
+  }
+
+
+  // Expected output size.  Gzip trailer keeps it modulo 2^32 when input is
+  // a single member, which is checked against the deflate limit of 1032:1.
+  static size_t SizeHint(Format format, const char *data, size_t length) {
+    size_t guess = length * 4 + 64;
+    if (format == Gzip && length >= 18) {
+      const unsigned char *p =
+          reinterpret_cast<const unsigned char*>(data) + length - 4;
+      size_t isize = p[0] | (p[1] << 8) | (p[2] << 16) | ((size_t)p[3] << 24);
+      if (isize <= length * 1032) {
+        guess = isize + 1;
+      }
+    }
+    return guess;
+  }
+
+#ifndef WITH_LIBDEFLATE
+  // Last used deflate stream is kept per worker thread and reset between
+  // calls, its state is only reallocated when format or level changes.
+  static z_stream *Deflater(Format format, int level) {
+    static __thread z_stream *stream;
+    static __thread int params;
+
+    int wanted = format * (MaxLevel + 1) + level;
+    if (stream != 0 && params == wanted) {
+      return stream;
+    }
+    if (stream == 0) {
+      stream = new(std::nothrow) z_stream;
+      COND_RETURN(stream == 0, 0);
+    } else {
+      deflateEnd(stream);
+    }
+    memset(stream, 0, sizeof(*stream));
+    if (deflateInit2(stream, level, Z_DEFLATED, WindowBits(format), 8,
+          Z_DEFAULT_STRATEGY) != Z_OK) {
+      delete stream;
+      stream = 0;
+      return 0;
+    }
+    params = wanted;
+    return stream;
+  }
+#endif
+
+#ifdef WITH_LIBDEFLATE
+  // (De)compressors are kept per worker thread, since allocating them costs
+  // more than compressing a small buffer.
+  static libdeflate_compressor *Compressor(int level) {
+    static __thread libdeflate_compressor *compressors[MaxLevel + 1];
+    if (compressors[level] == 0) {
+      compressors[level] = libdeflate_alloc_compressor(level);
+    }
+    return compressors[level];
+  }
+
+
+  static libdeflate_decompressor *Decompressor() {
+    static __thread libdeflate_decompressor *decompressor;
+    if (decompressor == 0) {
+      decompressor = libdeflate_alloc_decompressor();
+    }
+    return decompressor;
+  }
+#endif
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NODE_COMPRESS_REGISTRY_H__
+#define NODE_COMPRESS_REGISTRY_H__
+
+#include <string.h>
+#include <new>
+
+#include "anycodec.h"
+
+// Codecs built into the module, by library name.  Must be included after
+// processor definitions.
+class CodecRegistry {
+ public:
+  typedef AnyCodec *(*Factory)();
+
+  struct Entry {
+    const char *name;
+    Factory compressor;
+    Factory decompressor;
+  };
+
+ public:
+  static const Entry *Find(const char *name) {
+    for (const Entry *entry = entries_; entry->name != 0; ++entry) {
+      if (strcmp(entry->name, name) == 0) {
+        return entry;
+      }
+    }
+    return 0;
+  }
+
+
+  // Position of entry, for code that has to refer to it with an integer.
+  static int IndexOf(const Entry *entry) {
+    return entry - entries_;
+  }
+
+
+  static const Entry *At(int index) {
+    for (const Entry *entry = entries_; entry->name != 0; ++entry) {
+      if (entry - entries_ == index) {
+        return entry;
+      }
+    }
+    return 0;
+  }
+
+ private:
+  template <class Processor>
+  static AnyCodec *Create() {
+    return new(std::nothrow) AnyCodecImpl<Processor>();
+  }
+
+ private:
+  static const Entry entries_[];
+};
+const CodecRegistry::Entry CodecRegistry::entries_[] = {
+#ifdef WITH_GZIP
+  { "gzip", CodecRegistry::Create<GzipImpl>,
+    CodecRegistry::Create<GunzipImpl> },
+#endif
+#ifdef WITH_BZIP
+  { "bzip", CodecRegistry::Create<BzipImpl>,
+    CodecRegistry::Create<BunzipImpl> },
+#endif
+#ifdef WITH_LZ4
+  { "lz4", CodecRegistry::Create<Lz4Impl>,
+    CodecRegistry::Create<Unlz4Impl> },
+#endif
+#ifdef WITH_ZSTD
+  { "zstd", CodecRegistry::Create<ZstdImpl>,
+    CodecRegistry::Create<UnzstdImpl> },
+#endif
+#ifdef WITH_XZ
+  { "xz", CodecRegistry::Create<XzImpl>,
+    CodecRegistry::Create<UnxzImpl> },
+#endif
+  { 0, 0, 0 }
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NODE_COMPRESS_SLAB_H__
+#define NODE_COMPRESS_SLAB_H__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "utils.h"
+
+// Recycling allocator for library state, usable as zalloc/zfree.  Blocks
+// are rounded up to powers of two between MinShift and MaxShift and kept on
+// per-size free lists after release, up to MaxCachedBytes in total, so
+// streams allocated and released over and over (see GzipImpl hibernation)
+// reuse warm memory instead of going back to malloc.  Thread-safe.
+class Slab {
+ private:
+  enum {
+    MinShift = 12,
+    MaxShift = 20,
+    Classes = MaxShift - MinShift + 1,
+    MaxCachedBytes = 64 << 20,
+
+    // Class stored for blocks allocated with plain malloc().
+    Unpooled = 0xff
+  };
+
+  // Precedes each block, keeps the rest aligned as malloc() does.
+  union Header {
+    struct {
+      int cls;
+      Header *next;
+    } s;
+    double align;
+    void *align_ptr;
+  };
+
+ public:
+  static void *Alloc(void *opaque, unsigned items, unsigned size) {
+    size_t length = (size_t)items * size;
+    int cls = ClassOf(length);
+    Header *block = 0;
+
+    if (cls != Unpooled) {
+      pthread_mutex_lock(&mutex_);
+      block = free_[cls];
+      if (block != 0) {
+        free_[cls] = block->s.next;
+        cached_bytes_ -= BlockSize(cls);
+      }
+      pthread_mutex_unlock(&mutex_);
+      length = BlockSize(cls);
+    }
+
+    if (block == 0) {
+      block = static_cast<Header*>(malloc(sizeof(Header) + length));
+      COND_RETURN(block == 0, 0);
+    }
+    block->s.cls = cls;
+    return block + 1;
+  }
+
+
+  static void Free(void *opaque, void *address) {
+    if (address == 0) {
+      return;
+    }
+    Header *block = static_cast<Header*>(address) - 1;
+    int cls = block->s.cls;
+
+    if (cls != Unpooled) {
+      pthread_mutex_lock(&mutex_);
+      if (cached_bytes_ + BlockSize(cls) <= MaxCachedBytes) {
+        block->s.next = free_[cls];
+        free_[cls] = block;
+        cached_bytes_ += BlockSize(cls);
+        block = 0;
+      }
+      pthread_mutex_unlock(&mutex_);
+    }
+    free(block);
+  }
+
+ private:
+  static int ClassOf(size_t length) {
+    for (int cls = 0; cls < Classes; ++cls) {
+      if (length <= BlockSize(cls)) {
+        return cls;
+      }
+    }
+    return Unpooled;
+  }
+
+
+  static size_t BlockSize(int cls) {
+    return (size_t)1 << (MinShift + cls);
+  }
+
+ private:
+  static pthread_mutex_t mutex_;
+  static Header *free_[Classes];
+  static size_t cached_bytes_;
+};
+pthread_mutex_t Slab::mutex_ = PTHREAD_MUTEX_INITIALIZER;
+Slab::Header *Slab::free_[Slab::Classes];
+size_t Slab::cached_bytes_ = 0;
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NODE_COMPRESS_STATS_H__
+#define NODE_COMPRESS_STATS_H__
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <node.h>
+
+using namespace v8;
+
+// Monotonic clock in nanoseconds.
+static inline uint64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+// Counters updated from worker threads with atomic adds only, so they are
+// cheap enough to stay enabled in release builds.  Readers on V8 thread may
+// observe counters from a request in progress, which is fine for monitoring.
+class CodecStats {
+ public:
+  // Status codes of all supported libraries fit into [-16, 15].
+  enum { ErrorSlots = 32 };
+
+ public:
+  CodecStats() {
+    memset((void*)this, 0, sizeof(*this));
+  }
+
+  static void Add(volatile uint64_t &counter, uint64_t value) {
+    __sync_fetch_and_add(&counter, value);
+  }
+
+  void AddError(int status) {
+    Add(errors, 1);
+    Add(error_codes[status & (ErrorSlots - 1)], 1);
+  }
+
+  Local<Object> ToObject() const {
+    HandleScope scope;
+
+    Local<Object> result = Object::New();
+    result->Set(String::NewSymbol("streams"), Number::New(streams));
+    result->Set(String::NewSymbol("requests"), Number::New(requests));
+    result->Set(String::NewSymbol("bytesIn"), Number::New(bytes_in));
+    result->Set(String::NewSymbol("bytesOut"), Number::New(bytes_out));
+    result->Set(String::NewSymbol("ratio"),
+        Number::New(bytes_in ? (double)bytes_out / bytes_in : 0));
+    result->Set(String::NewSymbol("codecCalls"), Number::New(codec_calls));
+    result->Set(String::NewSymbol("writeNs"), Number::New(write_ns));
+    result->Set(String::NewSymbol("finishNs"), Number::New(finish_ns));
+    result->Set(String::NewSymbol("queueWaitNs"), Number::New(queue_wait_ns));
+    result->Set(String::NewSymbol("reallocs"), Number::New(reallocs));
+    result->Set(String::NewSymbol("errors"), Number::New(errors));
+
+    Local<Object> codes = Object::New();
+    for (int i = 0; i < ErrorSlots; ++i) {
+      if (error_codes[i] == 0) {
+        continue;
+      }
+      char key[8];
+      // Recover sign of the status from its slot.
+      snprintf(key, sizeof(key), "%d", i < ErrorSlots / 2 ? i : i - ErrorSlots);
+      codes->Set(String::New(key), Number::New(error_codes[i]));
+    }
+    result->Set(String::NewSymbol("errorCodes"), codes);
+    return scope.Close(result);
+  }
+
+ public:
+  volatile uint64_t streams;
+  volatile uint64_t requests;
+  volatile uint64_t bytes_in;
+  volatile uint64_t bytes_out;
+  volatile uint64_t codec_calls;
+  volatile uint64_t write_ns;
+  volatile uint64_t finish_ns;
+  volatile uint64_t queue_wait_ns;
+  volatile uint64_t reallocs;
+  volatile uint64_t errors;
+  volatile uint64_t error_codes[ErrorSlots];
+
+ private:
+  CodecStats(CodecStats&);
+  CodecStats(const CodecStats&);
+  CodecStats& operator=(CodecStats&);
+  CodecStats& operator=(const CodecStats&);
+};
+
+
+// Per-codec counters registered at module initialization, exposed to JS as
+// module-level getStats().
+class StatsRegistry {
+ public:
+  enum { MaxCodecs = 32 };
+
+ public:
+  static void Register(const char *name, CodecStats *stats) {
+    assert(count_ < MaxCodecs);
+    names_[count_] = name;
+    stats_[count_] = stats;
+    ++count_;
+  }
+
+  static Handle<Value> GetStats(const Arguments &args) {
+    HandleScope scope;
+
+    Local<Object> result = Object::New();
+    for (int i = 0; i < count_; ++i) {
+      result->Set(String::NewSymbol(names_[i]), stats_[i]->ToObject());
+    }
+    return scope.Close(result);
+  }
+
+ private:
+  static const char *names_[MaxCodecs];
+  static CodecStats *stats_[MaxCodecs];
+  static int count_;
+};
+const char *StatsRegistry::names_[StatsRegistry::MaxCodecs];
+CodecStats *StatsRegistry::stats_[StatsRegistry::MaxCodecs];
+int StatsRegistry::count_ = 0;
+
+#endif
@@ -0,0 +1,409 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <node.h>
+#include <node_buffer.h>
+#include <string.h>
+#include <stdlib.h>
+#include <new>
+
+#include "utils.h"
+#include "buffer.h"
+#include "oneshot.h"
+#include "cache.h"
+#include "anycodec.h"
+#include "registry.h"
+
+using namespace v8;
+using namespace node;
+
+// Two-tier compression: fast deflate output is returned at once, the same
+// input is compressed again at high level by background jobs, submitted at
+// the lowest priority MaxBackground at a time, so they only take otherwise
+// idle workers.  Deflate upgrade replaces the fast output in OutputCache.
+class TieredCodec {
+ private:
+  enum {
+    MaxBackground = 1
+  };
+
+  struct Request {
+    Request(Local<Value> inputBuffer, Local<Function> callback)
+      : buffer(Persistent<Value>::New(inputBuffer)),
+      data(Buffer::Data(inputBuffer->ToObject())),
+      length(Buffer::Length(inputBuffer->ToObject())),
+      callback(Persistent<Function>::New(callback)),
+      format(OneShot::Gzip), level(1), codec(0), upgrade_level(9),
+      use_cache(true), cached(false), hit(false), result(0), status(Z_OK),
+      upgrader(0), next(0)
+    {}
+
+    ~Request() {
+      buffer.Dispose();
+      callback.Dispose();
+      upgraded.Dispose();
+      if (result != 0) {
+        result->Unref();
+      }
+      delete upgrader;
+    }
+
+    Persistent<Value> buffer;
+    char *data;
+    size_t length;
+    Persistent<Function> callback;
+    Persistent<Function> upgraded;
+
+    OneShot::Format format;
+    int level;
+    const CodecRegistry::Entry *codec;
+    int upgrade_level;
+
+    bool use_cache;
+    bool cached;
+    bool hit;
+    OutputCache::Key key;
+
+    OutputCache::Entry *result;
+    int status;
+    AnyCodec *upgrader;
+
+    Request *next;
+  };
+
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+
+    NODE_SET_METHOD(target, "compressTiered", CompressTiered);
+  }
+
+ private:
+  static Handle<Value> CompressTiered(const Arguments &args) {
+    HandleScope scope;
+
+    if (args.Length() < 3 || !Buffer::HasInstance(args[0])) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Input must be of type Buffer"));
+      return ThrowException(exception);
+    }
+    if (!args[2]->IsFunction() ||
+        (args.Length() > 3 && !args[3]->IsUndefined() &&
+         !args[3]->IsFunction())) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Callback must be a function"));
+      return ThrowException(exception);
+    }
+
+    Request *request = new(std::nothrow) Request(args[0],
+        Local<Function>::Cast(args[2]));
+    if (request == 0) {
+      V8::LowMemoryNotification();
+      return ThrowException(Exception::Error(
+            String::New("Insufficient space")));
+    }
+    if (args.Length() > 3 && args[3]->IsFunction()) {
+      request->upgraded = Persistent<Function>::New(
+          Local<Function>::Cast(args[3]));
+    }
+    if (args[1]->IsObject()) {
+      Local<Value> exception = ParseOptions(args[1]->ToObject(), request);
+      if (!exception.IsEmpty()) {
+        delete request;
+        return ThrowException(exception);
+      }
+    }
+
+    eio_custom(DoFast, EIO_PRI_DEFAULT, DoHandleFast, request);
+    ev_ref(EV_DEFAULT_UC);
+    return Undefined();
+  }
+
+
+  // Returns exception for invalid options, empty handle otherwise.
+  static Local<Value> ParseOptions(Local<Object> options, Request *request) {
+    Local<Value> value = options->Get(String::NewSymbol("format"));
+    if (!value->IsUndefined()) {
+      String::AsciiValue name(value);
+      if (*name != 0 && strcmp(*name, "gzip") == 0) {
+        request->format = OneShot::Gzip;
+      } else if (*name != 0 && strcmp(*name, "zlib") == 0) {
+        request->format = OneShot::Zlib;
+      } else if (*name != 0 && strcmp(*name, "raw") == 0) {
+        request->format = OneShot::Raw;
+      } else {
+        return Exception::TypeError(
+            String::New("format must be one of 'gzip', 'zlib', 'raw'"));
+      }
+    }
+
+    value = options->Get(String::NewSymbol("level"));
+    if (!value->IsUndefined()) {
+      if (!value->IsInt32() || value->Int32Value() < -1 ||
+          value->Int32Value() > OneShot::MaxLevel) {
+        return Exception::TypeError(String::New("level is out of range"));
+      }
+      request->level = value->Int32Value();
+    }
+
+    value = options->Get(String::NewSymbol("upgradeCodec"));
+    if (!value->IsUndefined()) {
+      String::AsciiValue name(value);
+      request->codec = *name != 0 ? CodecRegistry::Find(*name) : 0;
+      if (request->codec == 0) {
+        return Exception::Error(
+            String::New("Library built without support for this codec."));
+      }
+      request->upgrade_level = -1;
+    }
+
+    value = options->Get(String::NewSymbol("upgradeLevel"));
+    if (!value->IsUndefined()) {
+      if (!value->IsInt32() || value->Int32Value() < -1 ||
+          (request->codec == 0 && value->Int32Value() > OneShot::MaxLevel)) {
+        return Exception::TypeError(
+            String::New("upgradeLevel is out of range"));
+      }
+      request->upgrade_level = value->Int32Value();
+    }
+
+    value = options->Get(String::NewSymbol("cache"));
+    if (!value->IsUndefined()) {
+      request->use_cache = value->BooleanValue();
+    }
+    return Local<Value>();
+  }
+
+
+  // Executed in worker thread.
+  static int DoFast(eio_req *req) {
+    Request *request = reinterpret_cast<Request*>(req->data);
+
+    request->cached = request->use_cache && OutputCache::Enabled();
+    if (request->cached) {
+      request->key = OneShotCacheKey(request->format, request->level,
+          request->data, request->length);
+      request->result = OutputCache::Find(request->key);
+      if (request->result != 0) {
+        request->hit = true;
+        request->status = Z_STREAM_END;
+        return 0;
+      }
+    }
+
+    OneShot::Blob out;
+    request->status = OneShot::Compress(request->format, request->level,
+        request->data, request->length, out);
+    if (!GzipUtils::IsError(request->status)) {
+      Keep(request, reinterpret_cast<char*>(out.Release()), out.length(),
+          request->cached);
+    }
+    return 0;
+  }
+
+
+  // Executed in V8 thread.
+  static int DoHandleFast(eio_req *req) {
+    HandleScope scope;
+    Request *request = reinterpret_cast<Request*>(req->data);
+
+    Local<Value> argv[2];
+    argv[0] = GzipUtils::GetException(request->status);
+    argv[1] = TakeResult(request);
+
+    TryCatch try_catch;
+    request->callback->Call(Context::GetCurrent()->Global(), 2, argv);
+    if (try_catch.HasCaught()) {
+      FatalException(try_catch);
+    }
+
+    // Deflate output served from cache is either upgraded or being upgraded
+    // by the request that cached it, so upgraded gets it as it is.  Upgrades
+    // to another codec aren't cached and run for every request.
+    bool fromCache = request->hit && request->codec == 0;
+    if (fromCache && !request->upgraded.IsEmpty()) {
+      Local<Value> upgradedArgv[4];
+      upgradedArgv[0] = argv[0];
+      upgradedArgv[1] = argv[1];
+      upgradedArgv[2] = UpgradeName(request);
+      upgradedArgv[3] = Local<Value>::New(True());
+
+      TryCatch upgraded_catch;
+      request->upgraded->Call(Context::GetCurrent()->Global(), 4,
+          upgradedArgv);
+      if (upgraded_catch.HasCaught()) {
+        FatalException(upgraded_catch);
+      }
+    }
+
+    if (GzipUtils::IsError(request->status) || fromCache ||
+        (request->upgraded.IsEmpty() &&
+         !(request->cached && request->codec == 0))) {
+      delete request;
+    } else {
+      if (queue_tail_ != 0) {
+        queue_tail_->next = request;
+      } else {
+        queue_head_ = request;
+      }
+      queue_tail_ = request;
+      ev_ref(EV_DEFAULT_UC);
+      Pump();
+    }
+
+    ev_unref(EV_DEFAULT_UC);
+    return 0;
+  }
+
+
+  // Executed in V8 thread.  Submits queued upgrades while fewer than
+  // MaxBackground are running.
+  static void Pump() {
+    while (running_ < MaxBackground && queue_head_ != 0) {
+      Request *request = queue_head_;
+      queue_head_ = request->next;
+      if (queue_head_ == 0) {
+        queue_tail_ = 0;
+      }
+      ++running_;
+      eio_custom(DoUpgrade, EIO_PRI_MIN, DoHandleUpgrade, request);
+    }
+  }
+
+
+  // Executed in worker thread.
+  static int DoUpgrade(eio_req *req) {
+    Request *request = reinterpret_cast<Request*>(req->data);
+
+    if (request->codec == 0) {
+      OneShot::Blob out;
+      request->status = OneShot::Compress(request->format,
+          request->upgrade_level, request->data, request->length, out);
+      if (!GzipUtils::IsError(request->status)) {
+        // Caller may have changed the buffer after the fast callback, then
+        // the key no longer describes the input and the upgrade isn't cached.
+        bool cache = request->cached &&
+            OneShotCacheKey(request->format, request->level, request->data,
+                request->length) == request->key;
+        Keep(request, reinterpret_cast<char*>(out.Release()), out.length(),
+            cache);
+      }
+      return 0;
+    }
+
+    AnyCodec *codec = request->codec->compressor();
+    if (codec == 0) {
+      request->status = Z_MEM_ERROR;
+      return 0;
+    }
+    int ret = codec->Init(request->upgrade_level);
+    if (!codec->IsError(ret)) {
+      ret = codec->Write(request->data, request->length);
+    }
+    if (!codec->IsError(ret)) {
+      ret = codec->Close();
+    }
+    if (codec->IsError(ret)) {
+      request->upgrader = codec;
+      request->status = ret;
+      return 0;
+    }
+
+    // Cached entries must stay in the format the key was made for.
+    request->status = Z_STREAM_END;
+    Keep(request, codec->Release(), codec->length(), false);
+    delete codec;
+    return 0;
+  }
+
+
+  // Executed in V8 thread.
+  static int DoHandleUpgrade(eio_req *req) {
+    HandleScope scope;
+    Request *request = reinterpret_cast<Request*>(req->data);
+
+    if (!request->upgraded.IsEmpty()) {
+      Local<Value> argv[4];
+      argv[0] = request->upgrader != 0 ?
+          request->upgrader->GetException(request->status) :
+          GzipUtils::GetException(request->status);
+      argv[1] = TakeResult(request);
+      argv[2] = UpgradeName(request);
+      argv[3] = Local<Value>::New(False());
+
+      TryCatch try_catch;
+      request->upgraded->Call(Context::GetCurrent()->Global(), 4, argv);
+      if (try_catch.HasCaught()) {
+        FatalException(try_catch);
+      }
+    }
+    delete request;
+
+    --running_;
+    Pump();
+    ev_unref(EV_DEFAULT_UC);
+    return 0;
+  }
+
+
+  // Replaces request result with output, inserting it into cache if asked.
+  static void Keep(Request *request, char *data, size_t length, bool cache) {
+    if (request->result != 0) {
+      request->result->Unref();
+    }
+    request->result = cache ?
+        OutputCache::Insert(request->key, data, length) :
+        OutputCache::Hold(data, length);
+    if (request->result == 0) {
+      request->status = Z_MEM_ERROR;
+    }
+  }
+
+
+  static Local<Value> UpgradeName(Request *request) {
+    return String::New(request->codec != 0 ? request->codec->name :
+        (request->format == OneShot::Gzip ? "gzip" :
+         (request->format == OneShot::Zlib ? "zlib" : "raw")));
+  }
+
+
+  // Buffer sharing memory with the result, which it takes over.
+  static Local<Value> TakeResult(Request *request) {
+    OutputCache::Entry *entry = request->result;
+    if (entry == 0 || GzipUtils::IsError(request->status)) {
+      return Local<Value>::New(Undefined());
+    }
+    request->result = 0;
+
+    return MakeBuffer(const_cast<char*>(entry->data()), entry->length(),
+        OutputCache::FreeBuffer, entry);
+  }
+
+ private:
+  static Request *queue_head_;
+  static Request *queue_tail_;
+  static int running_;
+};
+TieredCodec::Request *TieredCodec::queue_head_ = 0;
+TieredCodec::Request *TieredCodec::queue_tail_ = 0;
+int TieredCodec::running_ = 0;
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NODE_COMPRESS_TRACE_H__
+#define NODE_COMPRESS_TRACE_H__
+
+#include <new>
+#include <string>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <node.h>
+
+#include "stats.h"
+
+using namespace v8;
+
+// Timestamps of a single request.  Each field is written by the only thread
+// owning the request at that moment: V8 thread at enqueue/schedule/callback,
+// worker thread while processing.
+struct TraceSpan {
+  TraceSpan()
+    : enqueued(0), scheduled(0), started(0), finished(0), done(0), thread(0)
+  {}
+
+  uint64_t enqueued;
+  uint64_t scheduled;
+  uint64_t started;
+  uint64_t finished;
+  uint64_t done;
+  unsigned long thread;
+};
+
+
+struct TraceRecord {
+  const char *codec;
+  const void *stream;
+  int kind;
+  TraceSpan span;
+};
+
+
+// Log-linear histogram of nanosecond values in HDR histogram fashion:
+// values are grouped by power of two, each power split into SubBuckets
+// linear buckets, which gives ~3% relative precision.
+class TraceHistogram {
+ public:
+  enum {
+    SubBucketBits = 5,
+    SubBuckets = 1 << SubBucketBits,
+    Buckets = 64 * SubBuckets
+  };
+
+ public:
+  TraceHistogram()
+    : count_(0), min_(~(uint64_t)0), max_(0), sum_(0)
+  {
+    memset(counts_, 0, sizeof(counts_));
+  }
+
+  void Add(uint64_t value) {
+    ++counts_[Index(value)];
+    ++count_;
+    sum_ += value;
+    if (value < min_) min_ = value;
+    if (value > max_) max_ = value;
+  }
+
+  uint64_t Percentile(double p) const {
+    uint64_t rank = (uint64_t)(p / 100.0 * count_ + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < Buckets; ++i) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        uint64_t v = Value(i);
+        return v > max_ ? max_ : v;
+      }
+    }
+    return max_;
+  }
+
+  Local<Object> ToObject() const {
+    HandleScope scope;
+
+    Local<Object> result = Object::New();
+    result->Set(String::NewSymbol("count"), Number::New(count_));
+    result->Set(String::NewSymbol("min"), Number::New(count_ ? min_ : 0));
+    result->Set(String::NewSymbol("max"), Number::New(max_));
+    result->Set(String::NewSymbol("mean"),
+        Number::New(count_ ? (double)sum_ / count_ : 0));
+    result->Set(String::NewSymbol("p50"), Number::New(Percentile(50)));
+    result->Set(String::NewSymbol("p90"), Number::New(Percentile(90)));
+    result->Set(String::NewSymbol("p99"), Number::New(Percentile(99)));
+    result->Set(String::NewSymbol("p999"), Number::New(Percentile(99.9)));
+    return scope.Close(result);
+  }
+
+ private:
+  static int Index(uint64_t value) {
+    if (value < SubBuckets) {
+      return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - SubBucketBits;
+    return (shift + 1) * SubBuckets +
+        (int)((value >> shift) & (SubBuckets - 1));
+  }
+
+  // Upper bound of values falling into bucket.
+  static uint64_t Value(int index) {
+    if (index < SubBuckets) {
+      return index;
+    }
+    int shift = index / SubBuckets - 1;
+    uint64_t base = (uint64_t)(SubBuckets + index % SubBuckets) << shift;
+    return base + ((1ULL << shift) - 1);
+  }
+
+ private:
+  uint64_t counts_[Buckets];
+  uint64_t count_;
+  uint64_t min_;
+  uint64_t max_;
+  uint64_t sum_;
+};
+
+
+// Ring buffer of completed request traces.  Records are committed and
+// exported on V8 thread only, so the ring needs neither locks nor atomics;
+// worker threads only touch the TraceSpan of the request they own.
+class Tracer {
+ public:
+  enum { DefaultCapacity = 65536 };
+
+ public:
+  static bool Enabled() {
+    return enabled_;
+  }
+
+  static void Commit(const char *codec, const void *stream, int kind,
+      const TraceSpan &span) {
+    if (ring_ == 0) {
+      return;
+    }
+    TraceRecord &record = ring_[head_ % capacity_];
+    record.codec = codec;
+    record.stream = stream;
+    record.kind = kind;
+    record.span = span;
+    ++head_;
+  }
+
+  // setTracing(enabled [, capacity])
+  static Handle<Value> SetTracing(const Arguments &args) {
+    HandleScope scope;
+
+    bool enable = args.Length() > 0 && args[0]->BooleanValue();
+    size_t capacity = DefaultCapacity;
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+      if (!args[1]->IsUint32() || args[1]->Uint32Value() == 0) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("capacity must be a positive integer"));
+        return ThrowException(exception);
+      }
+      capacity = args[1]->Uint32Value();
+    }
+
+    if (enable && (ring_ == 0 || capacity != capacity_)) {
+      TraceRecord *ring = new(std::nothrow) TraceRecord[capacity];
+      if (ring == 0) {
+        Local<Value> exception = Exception::Error(
+            String::New("Insufficient space"));
+        return ThrowException(exception);
+      }
+      delete[] ring_;
+      ring_ = ring;
+      capacity_ = capacity;
+      head_ = 0;
+    }
+    enabled_ = enable;
+    return Undefined();
+  }
+
+  // getTrace(['chrome' | 'histogram'])
+  static Handle<Value> GetTrace(const Arguments &args) {
+    HandleScope scope;
+
+    bool chrome = true;
+    if (args.Length() > 0 && !args[0]->IsUndefined()) {
+      String::Utf8Value format(args[0]);
+      if (strcmp(*format, "histogram") == 0) {
+        chrome = false;
+      } else if (strcmp(*format, "chrome") != 0) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("format must be either 'chrome' or 'histogram'"));
+        return ThrowException(exception);
+      }
+    }
+    return scope.Close(chrome ? ExportChrome() : ExportHistograms());
+  }
+
+ private:
+  static size_t Size() {
+    return head_ < capacity_ ? head_ : capacity_;
+  }
+
+  static const TraceRecord &At(size_t i) {
+    return ring_[(head_ - Size() + i) % capacity_];
+  }
+
+  static void AppendEvent(std::string &json, const char *name,
+      const TraceRecord &r, unsigned long tid, uint64_t from, uint64_t to) {
+    char event[256];
+    snprintf(event, sizeof(event),
+        "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+        "\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,"
+        "\"args\":{\"stream\":\"%p\",\"kind\":%d}}",
+        json.size() > 16 ? "," : "", name, r.codec, tid,
+        from / 1000.0, (to - from) / 1000.0, r.stream, r.kind);
+    json += event;
+  }
+
+  // Chrome trace-event JSON: queueing and callback delivery are attributed
+  // to the stream, codec work to the worker thread that did it.
+  static Local<Value> ExportChrome() {
+    std::string json = "{\"traceEvents\":[";
+    for (size_t i = 0; i < Size(); ++i) {
+      const TraceRecord &r = At(i);
+      unsigned long stream = (unsigned long)r.stream;
+      AppendEvent(json, "queue", r, stream, r.span.enqueued, r.span.started);
+      AppendEvent(json, "process", r, r.span.thread,
+          r.span.started, r.span.finished);
+      AppendEvent(json, "callback", r, stream, r.span.finished, r.span.done);
+    }
+    json += "]}";
+    return String::New(json.data(), json.size());
+  }
+
+  static Local<Value> ExportHistograms() {
+    TraceHistogram *h = new(std::nothrow) TraceHistogram[5];
+    if (h == 0) {
+      return Exception::Error(String::New("Insufficient space"));
+    }
+    for (size_t i = 0; i < Size(); ++i) {
+      const TraceSpan &s = At(i).span;
+      h[0].Add(s.scheduled - s.enqueued);
+      h[1].Add(s.started - s.scheduled);
+      h[2].Add(s.finished - s.started);
+      h[3].Add(s.done - s.finished);
+      h[4].Add(s.done - s.enqueued);
+    }
+
+    Local<Object> result = Object::New();
+    result->Set(String::NewSymbol("streamQueue"), h[0].ToObject());
+    result->Set(String::NewSymbol("poolQueue"), h[1].ToObject());
+    result->Set(String::NewSymbol("process"), h[2].ToObject());
+    result->Set(String::NewSymbol("callback"), h[3].ToObject());
+    result->Set(String::NewSymbol("total"), h[4].ToObject());
+    delete[] h;
+    return result;
+  }
+
+ private:
+  static volatile bool enabled_;
+  static TraceRecord *ring_;
+  static size_t capacity_;
+  static size_t head_;
+};
+volatile bool Tracer::enabled_ = false;
+TraceRecord *Tracer::ring_ = 0;
+size_t Tracer::capacity_ = 0;
+size_t Tracer::head_ = 0;
+
+#endif
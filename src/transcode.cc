@@ -0,0 +1,267 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <node.h>
+#include <node_events.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "utils.h"
+#include "zlib.h"
+#include "anycodec.h"
+#include "registry.h"
+
+using namespace v8;
+using namespace node;
+
+// Statuses of inner codecs are kept with the codec they came from, so the
+// exception is the one the codec itself would throw.
+class TranscodeUtils {
+ public:
+  typedef ScopedBlob Blob;
+
+  enum Status {
+    Ok = 0,
+    StreamEnd = 1,
+    SequenceError = -1,
+    MemError = -2,
+    TrailingData = -3,
+
+    // Inner status s of registry entry i is -(slot << 16 | s + StatusBias),
+    // slot being 2 * i + 1 for decoder and 2 * i + 2 for encoder.
+    StatusBias = 0x8000,
+    StatusMask = 0xffff,
+    SlotShift = 16
+  };
+
+ public:
+  static int StatusOk() {
+    return Ok;
+  }
+
+
+  static int StatusSequenceError() {
+    return SequenceError;
+  }
+
+
+  static int StatusMemoryError() {
+    return MemError;
+  }
+
+
+  static int StatusEndOfStream() {
+    return StreamEnd;
+  }
+
+
+  static int CodecStatus(const CodecRegistry::Entry *entry, bool encoder,
+      int status) {
+    int slot = 2 * CodecRegistry::IndexOf(entry) + (encoder ? 2 : 1);
+    return -((slot << SlotShift) | (status + StatusBias));
+  }
+
+ public:
+  static bool IsError(int transcodeStatus) {
+    return transcodeStatus < 0;
+  }
+
+
+  static Local<Value> GetException(int transcodeStatus) {
+    if (!IsError(transcodeStatus)) {
+      return Local<Value>::New(Undefined());
+    }
+    switch (transcodeStatus) {
+      case SequenceError:
+        return Exception::Error(String::New(SequenceErrorMessage));
+      case MemError:
+        return Exception::Error(String::New(MemErrorMessage));
+      case TrailingData:
+        return Exception::Error(String::New(TrailingDataMessage));
+    }
+
+    int slot = (-transcodeStatus) >> SlotShift;
+    int status = ((-transcodeStatus) & StatusMask) - StatusBias;
+    const CodecRegistry::Entry *entry = CodecRegistry::At((slot - 1) / 2);
+    AnyCodec *codec = entry == 0 ? 0 :
+        (slot % 2 != 0 ? entry->decompressor() : entry->compressor());
+    if (codec == 0) {
+      return Exception::Error(String::New("Unknown error"));
+    }
+    Local<Value> exception = codec->GetException(status);
+    delete codec;
+    return exception;
+  }
+
+ private:
+  static const char SequenceErrorMessage[];
+  static const char MemErrorMessage[];
+  static const char TrailingDataMessage[];
+};
+const char TranscodeUtils::SequenceErrorMessage[] = "Call sequence error.";
+const char TranscodeUtils::MemErrorMessage[] = "Out of memory.";
+const char TranscodeUtils::TrailingDataMessage[] =
+    "Data after end of compressed stream.";
+
+
+// Decompressor feeding a compressor in the same worker call.  Decoded data
+// stays in the decoder's buffer, reused between chunks of at most about
+// DecodeChunk bytes, and the encoder appends straight to the output passed
+// to the caller.  Input after the end of the first stream is an error.
+class TranscodeImpl {
+#ifdef NEED_PUBLIC_FRIEND
+ public:
+#endif
+  friend class ZipLib<TranscodeImpl>;
+  friend class Codec<TranscodeImpl>;
+
+  typedef TranscodeUtils Utils;
+  typedef TranscodeUtils::Blob Blob;
+
+  static const char Name[];
+
+ private:
+  enum {
+    DecodeChunk = 1 << 20
+  };
+
+ private:
+  Handle<Value> Init(const Arguments &args) {
+    HandleScope scope;
+
+    want_buffer_ = false;
+    decoded_ = false;
+    decoder_ = 0;
+    encoder_ = 0;
+
+    if (args.Length() < 2 || !args[0]->IsString() || !args[1]->IsString()) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Codec names must be strings"));
+      return ThrowException(exception);
+    }
+    String::AsciiValue from(args[0]);
+    String::AsciiValue to(args[1]);
+    from_ = CodecRegistry::Find(*from);
+    to_ = CodecRegistry::Find(*to);
+    if (from_ == 0 || to_ == 0) {
+      Local<Value> exception = Exception::Error(
+          String::New("Library built without support for this codec."));
+      return ThrowException(exception);
+    }
+
+    int level = -1;
+    if (args.Length() > 2 && !args[2]->IsUndefined()) {
+      if (!args[2]->IsInt32()) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("level must be an integer"));
+        return ThrowException(exception);
+      }
+      level = args[2]->Int32Value();
+    }
+    if (args.Length() > 3 && !args[3]->IsUndefined()) {
+      want_buffer_ = args[3]->BooleanValue() ? true : false;
+    }
+
+    int ret = InitStream(level);
+    if (Utils::IsError(ret)) {
+      Destroy();
+      return ThrowException(Utils::GetException(ret));
+    }
+    return Undefined();
+  }
+
+
+  int InitStream(int level) {
+    decoder_ = from_->decompressor();
+    encoder_ = to_->compressor();
+    COND_RETURN(decoder_ == 0 || encoder_ == 0, Utils::MemError);
+
+    int ret = decoder_->Init(-1);
+    COND_RETURN(decoder_->IsError(ret),
+        Utils::CodecStatus(from_, false, ret));
+    ret = encoder_->Init(level);
+    COND_RETURN(encoder_->IsError(ret), Utils::CodecStatus(to_, true, ret));
+    return Utils::Ok;
+  }
+
+
+  // Decodes one chunk and encodes it, Codec calls again for the rest.
+  int Write(char *data, size_t &dataLength, Blob &out, bool flush) {
+    out.setUseBufferOut(want_buffer_);
+    COND_RETURN(decoded_, Utils::TrailingData);
+
+    int ret = decoder_->WriteSome(data, dataLength, DecodeChunk);
+    COND_RETURN(decoder_->IsError(ret),
+        Utils::CodecStatus(from_, false, ret));
+    decoded_ = decoder_->IsEnd(ret);
+    ret = Encode(out);
+    COND_RETURN(Utils::IsError(ret), ret);
+    COND_RETURN(decoded_ && dataLength > 0, Utils::TrailingData);
+    return Utils::Ok;
+  }
+
+
+  int Finish(Blob &out) {
+    out.setUseBufferOut(want_buffer_);
+
+    // Fails unless the decoder has seen the end of its stream.
+    int ret = decoder_->Close();
+    COND_RETURN(decoder_->IsError(ret),
+        Utils::CodecStatus(from_, false, ret));
+    decoded_ = true;
+    ret = Encode(out);
+    COND_RETURN(Utils::IsError(ret), ret);
+
+    ret = encoder_->Close(out);
+    COND_RETURN(encoder_->IsError(ret), Utils::CodecStatus(to_, true, ret));
+    return Utils::StreamEnd;
+  }
+
+
+  void Destroy() {
+    delete decoder_;
+    decoder_ = 0;
+    delete encoder_;
+    encoder_ = 0;
+  }
+
+ private:
+  // Passes decoded data to the encoder, which appends its output to out.
+  int Encode(Blob &out) {
+    int ret = encoder_->Write(const_cast<char*>(decoder_->data()),
+        decoder_->length(), out);
+    COND_RETURN(encoder_->IsError(ret), Utils::CodecStatus(to_, true, ret));
+    decoder_->Clear();
+    return Utils::Ok;
+  }
+
+ private:
+  bool want_buffer_;
+  bool decoded_;
+  const CodecRegistry::Entry *from_;
+  const CodecRegistry::Entry *to_;
+  AnyCodec *decoder_;
+  AnyCodec *encoder_;
+};
+const char TranscodeImpl::Name[] = "Transcode";
+typedef ZipLib<TranscodeImpl> Transcode;
@@ -23,9 +23,12 @@
 #ifndef NODE_COMPRESS_UTILS_H__
 #define NODE_COMPRESS_UTILS_H__
 
+#include <algorithm>
 #include <new>
 
 #include <assert.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <pthread.h>
 
@@ -37,6 +40,12 @@
     if (cond) \
       return (ret);
 
+// zlib, bzip2 and igzip count bytes in unsigned int, larger buffers are
+// passed to them in slices of at most this length.
+static inline unsigned int SliceLength(size_t length) {
+  return length > UINT_MAX ? UINT_MAX : (unsigned int)length;
+}
+
 #ifdef DEBUG
 
 #include <stdio.h>
@@ -79,12 +88,12 @@ template <class T>
 class ScopedOutputBuffer {
  public:
   ScopedOutputBuffer() 
-    : data_(0), capacity_(0), length_(0), use_buffers_(false)
+    : data_(0), capacity_(0), length_(0), reallocs_(0), use_buffers_(false)
   {
   }
 
   ScopedOutputBuffer(size_t initialCapacity)
-    : data_(0), capacity_(0), length_(0), use_buffers_(false)
+    : data_(0), capacity_(0), length_(0), reallocs_(0), use_buffers_(false)
   {
     GrowBy(initialCapacity);
   }
@@ -108,6 +117,12 @@ class ScopedOutputBuffer {
     length_ += sz;
   }
 
+
+  void DecreaseLengthBy(size_t sz) {
+    assert(sz <= length_);
+    length_ -= sz;
+  }
+
   
   void ResetLength() {
     length_ = 0;
@@ -123,6 +138,16 @@ class ScopedOutputBuffer {
   }
 
 
+  // Passes ownership of data to the caller, who must free() it.
+  T* Release() {
+    T *data = data_;
+    data_ = 0;
+    capacity_ = 0;
+    length_ = 0;
+    return data;
+  }
+
+
   T* data() const {
     return data_;
   }
@@ -142,6 +167,11 @@ class ScopedOutputBuffer {
     return capacity_ - length_;
   }
 
+
+  size_t reallocs() const {
+    return reallocs_;
+  }
+
   void setUseBufferOut(bool use_buffers) {
     use_buffers_ = use_buffers;
   }
@@ -149,8 +179,25 @@ class ScopedOutputBuffer {
   bool getUseBufferOut() {
     return use_buffers_;
   }
+
+
+  // Exchanges contents with a buffer of another byte type, so that a codec
+  // can append straight to output of another one.
+  template <class U>
+  void Swap(ScopedOutputBuffer<U> &other) {
+    assert(sizeof(T) == sizeof(U));
+    T *data = data_;
+    data_ = reinterpret_cast<T*>(other.data_);
+    other.data_ = reinterpret_cast<U*>(data);
+    std::swap(capacity_, other.capacity_);
+    std::swap(length_, other.length_);
+    std::swap(reallocs_, other.reallocs_);
+    std::swap(use_buffers_, other.use_buffers_);
+  }
  
  private:
+  template <class U> friend class ScopedOutputBuffer;
+
   bool GrowTo(size_t sz) {
     if (sz == 0) {
       return true;
@@ -163,6 +210,7 @@ class ScopedOutputBuffer {
     }
     data_ = tmp;
     capacity_ = sz;
+    ++reallocs_;
     return true;
   }
 
@@ -170,6 +218,7 @@ class ScopedOutputBuffer {
   T* data_;
   size_t capacity_;
   size_t length_;
+  size_t reallocs_;
   bool use_buffers_;
 
  private:
@@ -0,0 +1,393 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <node.h>
+#include <node_events.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <lzma.h>
+
+#include "utils.h"
+#include "zlib.h"
+
+using namespace v8;
+using namespace node;
+
+class XzUtils {
+ public:
+  typedef ScopedBlob Blob;
+
+  enum Status {
+    Ok = 0,
+    StreamEnd = 1,
+    SequenceError = -1,
+    MemError = -2,
+    DataError = -3,
+    UnexpectedEof = -4,
+    FormatError = -5,
+    MemLimitError = -6,
+    OptionsError = -7,
+    LibraryError = -8
+  };
+
+ public:
+  static int StatusOk() {
+    return Ok;
+  }
+
+
+  static int StatusSequenceError() {
+    return SequenceError;
+  }
+
+
+  static int StatusMemoryError() {
+    return MemError;
+  }
+
+
+  static int StatusEndOfStream() {
+    return StreamEnd;
+  }
+
+ public:
+  static bool IsError(int xzStatus) {
+    return xzStatus < 0;
+  }
+
+
+  // LZMA_BUF_ERROR only means no progress was possible, callers decide
+  // whether it is an error.
+  static int FromResult(lzma_ret result) {
+    switch (result) {
+      case LZMA_OK:
+      case LZMA_BUF_ERROR:
+        return Ok;
+      case LZMA_STREAM_END:
+        return StreamEnd;
+      case LZMA_MEM_ERROR:
+        return MemError;
+      case LZMA_MEMLIMIT_ERROR:
+        return MemLimitError;
+      case LZMA_FORMAT_ERROR:
+        return FormatError;
+      case LZMA_OPTIONS_ERROR:
+        return OptionsError;
+      case LZMA_DATA_ERROR:
+        return DataError;
+      case LZMA_PROG_ERROR:
+        return SequenceError;
+
+      default:
+        return LibraryError;
+    }
+  }
+
+
+  static Local<Value> GetException(int xzStatus) {
+    if (!IsError(xzStatus)) {
+      return Local<Value>::New(Undefined());
+    } else {
+      switch (xzStatus) {
+        case SequenceError:
+          return Exception::Error(String::New(SequenceErrorMessage));
+        case MemError:
+          return Exception::Error(String::New(MemErrorMessage));
+        case DataError:
+          return Exception::Error(String::New(DataErrorMessage));
+        case UnexpectedEof:
+          return Exception::Error(String::New(UnexpectedEofMessage));
+        case FormatError:
+          return Exception::Error(String::New(FormatErrorMessage));
+        case MemLimitError:
+          return Exception::Error(String::New(MemLimitErrorMessage));
+        case OptionsError:
+          return Exception::Error(String::New(OptionsErrorMessage));
+        case LibraryError:
+          return Exception::Error(String::New(LibraryErrorMessage));
+
+        default:
+          return Exception::Error(String::New("Unknown error"));
+      }
+    }
+  }
+
+ private:
+  static const char SequenceErrorMessage[];
+  static const char MemErrorMessage[];
+  static const char DataErrorMessage[];
+  static const char UnexpectedEofMessage[];
+  static const char FormatErrorMessage[];
+  static const char MemLimitErrorMessage[];
+  static const char OptionsErrorMessage[];
+  static const char LibraryErrorMessage[];
+};
+const char XzUtils::SequenceErrorMessage[] = "Call sequence error.";
+const char XzUtils::MemErrorMessage[] = "Out of memory.";
+const char XzUtils::DataErrorMessage[] = "Input data corrupted.";
+const char XzUtils::UnexpectedEofMessage[] = "Unexpected end of input.";
+const char XzUtils::FormatErrorMessage[] = "Input is not in .xz format.";
+const char XzUtils::MemLimitErrorMessage[] = "Decompression needs more memory "
+  "than allowed by memlimit.";
+const char XzUtils::OptionsErrorMessage[] = "Unsupported compression "
+  "options.";
+const char XzUtils::LibraryErrorMessage[] = "liblzma error.";
+
+
+class XzImpl {
+#ifdef NEED_PUBLIC_FRIEND
+ public:
+#endif
+  friend class ZipLib<XzImpl>;
+  friend class Codec<XzImpl>;
+
+  typedef XzUtils Utils;
+  typedef XzUtils::Blob Blob;
+
+ private:
+  static const char Name[];
+
+ private:
+  // Xz(preset, use_buffers, extreme, threads)
+  Handle<Value> Init(const Arguments &args) {
+    HandleScope scope;
+
+    int preset = LZMA_PRESET_DEFAULT;
+    int threads = 0;
+    bool extreme = false;
+
+    want_buffer_ = false;
+    lzma_stream init = LZMA_STREAM_INIT;
+    stream_ = init;
+
+    if (args.Length() > 0 && !args[0]->IsUndefined()) {
+      if (!args[0]->IsInt32()) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("preset must be an integer"));
+        return ThrowException(exception);
+      }
+      preset = args[0]->Int32Value();
+    }
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+      want_buffer_ = args[1]->BooleanValue() ? true : false;
+    }
+    if (args.Length() > 2 && !args[2]->IsUndefined()) {
+      extreme = args[2]->BooleanValue() ? true : false;
+    }
+    if (args.Length() > 3 && !args[3]->IsUndefined()) {
+      if (!args[3]->IsInt32()) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("threads must be an integer"));
+        return ThrowException(exception);
+      }
+      threads = args[3]->Int32Value();
+    }
+
+    int ret = InitStream(preset, extreme, threads);
+    if (Utils::IsError(ret)) {
+      return ThrowException(Utils::GetException(ret));
+    }
+    return Undefined();
+  }
+
+
+  int Init(int level) {
+    want_buffer_ = true;
+    lzma_stream init = LZMA_STREAM_INIT;
+    stream_ = init;
+    return InitStream(level < 0 ? LZMA_PRESET_DEFAULT : level, false, 0);
+  }
+
+
+  // Zero threads selects single-threaded encoder, negative means one thread
+  // per CPU.  Multithreaded encoder splits input into independent blocks
+  // (3 times dictionary size by default).
+  int InitStream(int preset, bool extreme, int threads) {
+    COND_RETURN(preset < 0 || preset > 9, Utils::OptionsError);
+
+    uint32_t flags = preset | (extreme ? LZMA_PRESET_EXTREME : 0);
+    if (threads == 0) {
+      return Utils::FromResult(
+          lzma_easy_encoder(&stream_, flags, LZMA_CHECK_CRC64));
+    }
+
+    lzma_mt mt;
+    memset(&mt, 0, sizeof(mt));
+    mt.threads = threads > 0 ? threads : lzma_cputhreads();
+    if (mt.threads == 0) {
+      mt.threads = 1;
+    }
+    mt.preset = flags;
+    mt.check = LZMA_CHECK_CRC64;
+    return Utils::FromResult(lzma_stream_encoder_mt(&stream_, &mt));
+  }
+
+
+  int Write(char *data, size_t &dataLength, Blob &out, bool flush) {
+    out.setUseBufferOut(want_buffer_);
+    stream_.next_in = reinterpret_cast<uint8_t*>(data);
+    stream_.avail_in = dataLength;
+    stream_.next_out = reinterpret_cast<uint8_t*>(out.data()) + out.length();
+    size_t initAvail = stream_.avail_out = out.avail();
+
+    int ret = Utils::FromResult(lzma_code(&stream_, LZMA_RUN));
+    if (!Utils::IsError(ret)) {
+      dataLength = stream_.avail_in;
+      out.IncreaseLengthBy(initAvail - stream_.avail_out);
+    }
+    return ret;
+  }
+
+
+  int Finish(Blob &out) {
+    out.setUseBufferOut(want_buffer_);
+    stream_.next_in = NULL;
+    stream_.avail_in = 0;
+    stream_.next_out = reinterpret_cast<uint8_t*>(out.data()) + out.length();
+    size_t initAvail = stream_.avail_out = out.avail();
+
+    int ret = Utils::FromResult(lzma_code(&stream_, LZMA_FINISH));
+    if (!Utils::IsError(ret)) {
+      out.IncreaseLengthBy(initAvail - stream_.avail_out);
+    }
+    return ret;
+  }
+
+
+  void Destroy() {
+    lzma_end(&stream_);
+  }
+
+ private:
+  bool want_buffer_;
+  lzma_stream stream_;
+};
+const char XzImpl::Name[] = "Xz";
+typedef ZipLib<XzImpl> Xz;
+
+
+class UnxzImpl {
+#ifdef NEED_PUBLIC_FRIEND
+ public:
+#endif
+  friend class ZipLib<UnxzImpl>;
+  friend class Codec<UnxzImpl>;
+
+  typedef XzUtils Utils;
+  typedef XzUtils::Blob Blob;
+
+ private:
+  static const char Name[];
+
+ private:
+  // Unxz(use_buffers, memlimit)
+  Handle<Value> Init(const Arguments &args) {
+    HandleScope scope;
+
+    uint64_t memlimit = ~(uint64_t)0;
+
+    want_buffer_ = false;
+    lzma_stream init = LZMA_STREAM_INIT;
+    stream_ = init;
+
+    if (args.Length() > 0 && !args[0]->IsUndefined()) {
+      want_buffer_ = args[0]->BooleanValue() ? true : false;
+    }
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+      if (!args[1]->IsNumber() || args[1]->NumberValue() < 1) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("memlimit must be a positive number"));
+        return ThrowException(exception);
+      }
+      memlimit = args[1]->IntegerValue();
+    }
+
+    int ret = InitStream(memlimit);
+    if (Utils::IsError(ret)) {
+      return ThrowException(Utils::GetException(ret));
+    }
+    return Undefined();
+  }
+
+
+  int Init(int level) {
+    want_buffer_ = true;
+    lzma_stream init = LZMA_STREAM_INIT;
+    stream_ = init;
+    return InitStream(~(uint64_t)0);
+  }
+
+
+  int InitStream(uint64_t memlimit) {
+    return Utils::FromResult(lzma_stream_decoder(&stream_, memlimit, 0));
+  }
+
+
+  int Write(char *data, size_t &dataLength, Blob &out, bool flush) {
+    out.setUseBufferOut(want_buffer_);
+    stream_.next_in = reinterpret_cast<uint8_t*>(data);
+    stream_.avail_in = dataLength;
+    stream_.next_out = reinterpret_cast<uint8_t*>(out.data()) + out.length();
+    size_t initAvail = stream_.avail_out = out.avail();
+
+    int ret = Utils::FromResult(lzma_code(&stream_, LZMA_RUN));
+    if (!Utils::IsError(ret)) {
+      dataLength = stream_.avail_in;
+      out.IncreaseLengthBy(initAvail - stream_.avail_out);
+    }
+    return ret;
+  }
+
+
+  // Decoder may still hold output when input ends; no progress at all
+  // means stream is truncated.
+  int Finish(Blob &out) {
+    out.setUseBufferOut(want_buffer_);
+    stream_.next_in = NULL;
+    stream_.avail_in = 0;
+    stream_.next_out = reinterpret_cast<uint8_t*>(out.data()) + out.length();
+    size_t initAvail = stream_.avail_out = out.avail();
+
+    lzma_ret result = lzma_code(&stream_, LZMA_FINISH);
+    COND_RETURN(result == LZMA_BUF_ERROR, Utils::UnexpectedEof);
+
+    int ret = Utils::FromResult(result);
+    if (!Utils::IsError(ret)) {
+      out.IncreaseLengthBy(initAvail - stream_.avail_out);
+    }
+    return ret;
+  }
+
+
+  void Destroy() {
+    lzma_end(&stream_);
+  }
+
+ private:
+  bool want_buffer_;
+  lzma_stream stream_;
+};
+const char UnxzImpl::Name[] = "Unxz";
+typedef ZipLib<UnxzImpl> Unxz;
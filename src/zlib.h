@@ -32,37 +32,41 @@
 #include <node_buffer.h>
 #include <node_version.h>
 #include <assert.h>
+#include <stdlib.h>
 
 #include "utils.h"
+#include "buffer.h"
+#include "codec.h"
+#include "stats.h"
+#include "trace.h"
 
 using namespace v8;
 using namespace node;
 
 template <class Processor>
 class ZipLib : ObjectWrap {
- private:
-  enum State {
-    Idle,
-    Destroyed,
-    Data,
-    Eos,
-    Error
-  };
-
  private:
   typedef typename Processor::Utils Utils;
   typedef typename Processor::Blob Blob;
 
   typedef ZipLib<Processor> Self;
-  typedef StateTransition<State> Transition;
+  typedef Codec<Processor> Stream;
+  typedef typename Stream::Transition Transition;
 
   struct Request {
    public:
     enum Kind {
       RWrite,
       RClose,
-      RDestroy
+      RDestroy,
+      RHibernate
+    };
+    // One Buffer of a gather write.
+    struct Piece {
+      char *data;
+      size_t length;
     };
+
    private:
     Request(ZipLib *self, Local<Value> inputBuffer, Local<Function> callback, bool flush)
       : kind_(RWrite), self_(self), next_(0),
@@ -74,24 +78,35 @@ class ZipLib : ObjectWrap {
       data_(GetBuffer(inputBuffer)->data()),
       length_(GetBuffer(inputBuffer)->length()),
 #endif
-      flush_(flush),
+      owned_(false), pieces_(0), count_(0),
+      flush_(flush), cancelled_(false),
+      callback_(Persistent<Function>::New(callback))
+    {}
+
+    // String or array of Buffers, data is filled in by the factory.
+    Request(ZipLib *self, Local<Value> input, bool flush,
+        Local<Function> callback)
+      : kind_(RWrite), self_(self), next_(0),
+      buffer_(Persistent<Value>::New(input)),
+      data_(0), length_(0), owned_(false), pieces_(0), count_(0),
+      flush_(flush), cancelled_(false),
       callback_(Persistent<Function>::New(callback))
     {}
     
     Request(ZipLib *self, Local<Function> callback)
-      : kind_(RClose), self_(self), next_(0),
+      : kind_(RClose), self_(self), next_(0), owned_(false), pieces_(0),
+      count_(0), flush_(false), cancelled_(false),
       callback_(Persistent<Function>::New(callback))
     {}
 
-    Request(ZipLib *self)
-      : kind_(RDestroy), self_(self), next_(0)
+    Request(ZipLib *self, Kind kind)
+      : kind_(kind), self_(self), next_(0), owned_(false), pieces_(0),
+      count_(0), flush_(false), cancelled_(false)
     {}
 
    public:
     ~Request() {
-      if (!buffer_.IsEmpty()) {
-        buffer_.Dispose();
-      }
+      ReleaseInput();
       if (!callback_.IsEmpty()) {
         callback_.Dispose();
       }
@@ -111,6 +126,17 @@ class ZipLib : ObjectWrap {
       return new(std::nothrow) Request(self, inputBuffer, callback, flush);
     }
 
+    static Request* WriteString(Self *self, Local<String> input,
+        enum encoding encoding, Local<Function> callback, bool flush) {
+      Request *request = new(std::nothrow) Request(self, input, flush,
+          callback);
+      if (request != 0 && !request->SetString(input, encoding)) {
+        delete request;
+        request = 0;
+      }
+      return request;
+    }
+
     static Request* Close(Self *self, Local<Function> callback) {
       //DEBUG_P("CLOSE");
       return new(std::nothrow) Request(self, callback);
@@ -118,26 +144,148 @@ class ZipLib : ObjectWrap {
 
     static Request* Destroy(Self *self) {
       //DEBUG_P("DESTROY");
-      return new(std::nothrow) Request(self);
+      return new(std::nothrow) Request(self, RDestroy);
+    }
+
+    static Request* Hibernate(Self *self) {
+      return new(std::nothrow) Request(self, RHibernate);
+    }
+
+    // buffers is a private array of Buffers, see Write().
+    static Request* WriteGather(Self *self, Local<Array> buffers,
+        Local<Function> callback, bool flush) {
+      Request *request = new(std::nothrow) Request(self, buffers, flush,
+          callback);
+      COND_RETURN(request == 0, 0);
+      request->count_ = buffers->Length();
+      request->pieces_ = new(std::nothrow) Piece[request->count_];
+      if (request->pieces_ == 0) {
+        delete request;
+        return 0;
+      }
+      for (int i = 0; i < request->count_; ++i) {
+        Local<Object> buffer = buffers->Get(i)->ToObject();
+        request->pieces_[i].data = Buffer::Data(buffer);
+        request->pieces_[i].length = Buffer::Length(buffer);
+        request->length_ += request->pieces_[i].length;
+      }
+      return request;
+    }
+
+   private:
+    // One-byte external strings are read in place, pinned as Buffers are.
+    // Others are encoded once, straight into memory owned by the request.
+    bool SetString(Local<String> input, enum encoding encoding) {
+      if (input->IsExternalAscii()) {
+        const String::ExternalAsciiStringResource *resource =
+            input->GetExternalAsciiStringResource();
+        data_ = const_cast<char*>(resource->data());
+        length_ = resource->length();
+        return true;
+      }
+
+      ssize_t bytes = DecodeBytes(input, encoding);
+      COND_RETURN(bytes < 0, false);
+      length_ = bytes;
+      data_ = reinterpret_cast<char*>(malloc(length_ > 0 ? length_ : 1));
+      COND_RETURN(data_ == 0, false);
+      owned_ = true;
+
+      switch (encoding) {
+        case UTF8:
+          input->WriteUtf8(data_, length_, 0,
+              String::HINT_MANY_WRITES_EXPECTED);
+          break;
+
+        case ASCII:
+          input->WriteAscii(data_, 0, length_,
+              String::HINT_MANY_WRITES_EXPECTED);
+          break;
+
+        default: {
+          // Binary keeps low byte of each character.
+          uint16_t chunk[512];
+          for (size_t offset = 0; offset < length_; offset += 512) {
+            int n = length_ - offset < 512 ? length_ - offset : 512;
+            input->Write(chunk, offset, n, String::HINT_MANY_WRITES_EXPECTED);
+            for (int i = 0; i < n; ++i) {
+              data_[offset + i] = (char)chunk[i];
+            }
+          }
+          break;
+        }
+      }
+      return true;
     }
 
    public:
+    // Callback is to report cancellation instead of the result.
+    void Cancel() {
+      cancelled_ = true;
+    }
+
+    // Unpins input Buffers of a request which is not going to run.
+    void ReleaseInput() {
+      if (!buffer_.IsEmpty()) {
+        buffer_.Dispose();
+        buffer_.Clear();
+      }
+      if (owned_) {
+        free(data_);
+        owned_ = false;
+      }
+      delete[] pieces_;
+      pieces_ = 0;
+      data_ = 0;
+      length_ = 0;
+      count_ = 0;
+    }
+
     void setStatus(int status) {
       status_ = status;
     }
+
+    void setQueuedAt(uint64_t queuedAt) {
+      queued_at_ = queuedAt;
+    }
+
+    uint64_t queuedAt() const {
+      return queued_at_;
+    }
+
+    TraceSpan &span() {
+      return span_;
+    }
+
+    bool traced() const {
+      return span_.enqueued != 0;
+    }
     
     char* buffer() const {
       return data_;
     }
 
-    int length() const {
+    size_t length() const {
       return length_;
     }
 
+    // Gather write input, count() is 0 otherwise.
+    const Piece *pieces() const {
+      return pieces_;
+    }
+
+    int count() const {
+      return count_;
+    }
+
     bool flush() const {
       return flush_;
     }
 
+    bool cancelled() const {
+      return cancelled_;
+    }
+
     Self *self() const {
       assert(this != 0);
       return self_;
@@ -178,8 +326,13 @@ class ZipLib : ObjectWrap {
     // store raw buffer data and length.
     Persistent<Value> buffer_;
     char *data_;
-    int length_;
+    size_t length_;
+    // data_ holds encoded string input, freed with the request.
+    bool owned_;
+    Piece *pieces_;
+    int count_;
     bool flush_;
+    bool cancelled_;
 
     Persistent<Function> callback_;
 
@@ -187,6 +340,11 @@ class ZipLib : ObjectWrap {
     Blob out_;
     int status_;
 
+    // Time of PushRequest, for queue wait accounting.
+    uint64_t queued_at_;
+    // Filled in only when tracing was enabled at PushRequest.
+    TraceSpan span_;
+
   };
 
  public:
@@ -206,17 +364,20 @@ class ZipLib : ObjectWrap {
     Local<Function> slow_buffer_constructor = Local<Function>::Cast(buffer_obj->Get(String::New("SlowBuffer")));
     Self::slow_buffer_constructor_ = Persistent<Function>::New(slow_buffer_constructor);
 
-    Local<Function> buffer_constructor = Local<Function>::Cast(globalObj->Get(String::New("Buffer")));
-    Self::buffer_constructor_ = Persistent<Function>::New(buffer_constructor);
-
     NODE_SET_PROTOTYPE_METHOD(Self::constructor_, "write", Write);
     NODE_SET_PROTOTYPE_METHOD(Self::constructor_, "close", Close);
     NODE_SET_PROTOTYPE_METHOD(Self::constructor_, "destroy", Destroy);
+    NODE_SET_PROTOTYPE_METHOD(Self::constructor_, "stats", Stats);
+    NODE_SET_PROTOTYPE_METHOD(Self::constructor_, "fork", Fork);
+    NODE_SET_PROTOTYPE_METHOD(Self::constructor_, "setIdleTimeout",
+        SetIdleTimeout);
 
     NODE_SET_METHOD(Self::constructor_, "createInstance_", Create);
 
     target->Set(String::NewSymbol(Processor::Name),
         Self::constructor_->GetFunction());
+
+    StatsRegistry::Register(Processor::Name, &Self::codec_stats_);
   }
 
  public:
@@ -229,13 +390,14 @@ class ZipLib : ObjectWrap {
 
     result->tail_req_ = (Request*)0;
     DEBUG_P("tail_req_:%p",result->tail_req_);
-    Transition t(result->state_, Self::Error);
-    Handle<Value> exception = result->processor_.Init(args);
+    Transition t(result->codec_.state(), Stream::Error);
+    Handle<Value> exception = result->codec_.processor().Init(args);
     if (!exception->IsUndefined()) {
       return exception;
     }
 
-    t.alter(Self::Data);
+    t.alter(Stream::Data);
+    result->Count(&CodecStats::streams, 1);
     return args.This();
   }
 
@@ -258,34 +420,84 @@ class ZipLib : ObjectWrap {
   }
 
 
+  // write(buffer, [flush], callback),
+  // write(string, [encoding], [flush], callback), encoding is 'utf8',
+  // 'ascii' or 'binary', [utf8], or write([buffers], [flush], callback).
   static Handle<Value> Write(const Arguments& args) {
     HandleScope scope;
     bool flush = false;
 
-    if (!Buffer::HasInstance(args[0])) {
+    bool isString = args[0]->IsString();
+    Local<Array> gather;
+    if (args[0]->IsArray()) {
+      gather = CopyBuffers(Local<Array>::Cast(args[0]));
+      if (gather.IsEmpty()) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("Input must be an array of Buffers"));
+        return ThrowException(exception);
+      }
+    } else if (!isString && !Buffer::HasInstance(args[0])) {
       Local<Value> exception = Exception::TypeError(
-          String::New("Input must be of type Buffer"));
+          String::New("Input must be of type Buffer or string"));
       return ThrowException(exception);
     }
 
+    int optional = 1;
+    enum encoding encoding = UTF8;
+    if (isString && args.Length() > 1 && args[1]->IsString()) {
+      encoding = ParseEncoding(args[1], UTF8);
+      if (encoding != UTF8 && encoding != ASCII && encoding != BINARY) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("Unsupported string encoding"));
+        return ThrowException(exception);
+      }
+      optional = 2;
+    }
+
     Local<Function> cb;
-    if (args.Length() > 1 && !args[args.Length()-1]->IsUndefined()) {
+    if (args.Length() > optional &&
+        !args[args.Length()-1]->IsUndefined()) {
       if (!args[args.Length()-1]->IsFunction()) {
         return ThrowCallbackExpected();
       }
       cb = Local<Function>::Cast(args[args.Length()-1]);
 
-      if(args.Length() > 2 && !args[1]->IsUndefined()) {
-        if(args[1]->BooleanValue()) flush = true;
+      if(args.Length() > optional + 1 && !args[optional]->IsUndefined()) {
+        if(args[optional]->BooleanValue()) flush = true;
       }
     }
 
     Self *self = ObjectWrap::Unwrap<Self>(args.This());
-    Request *request = Request::Write(self, args[0], cb, flush);
+    Request *request;
+    if (!gather.IsEmpty()) {
+      request = Request::WriteGather(self, gather, cb, flush);
+    } else if (isString) {
+      request = Request::WriteString(self, args[0]->ToString(), encoding, cb,
+          flush);
+    } else {
+      request = Request::Write(self, args[0], cb, flush);
+    }
     return self->PushRequest(request);
   }
 
 
+  // Returns copy of array, so that caller may reuse it, or empty handle
+  // unless every item is a Buffer.
+  static Local<Array> CopyBuffers(Local<Array> buffers) {
+    HandleScope scope;
+
+    Local<Array> result = Array::New(buffers->Length());
+    for (uint32_t i = 0; i < buffers->Length(); ++i) {
+      Local<Value> buffer = buffers->Get(i);
+      if (!Buffer::HasInstance(buffer)) {
+        return Local<Array>();
+      }
+      result->Set(i, buffer);
+    }
+    return scope.Close(result);
+  }
+
+
   static Handle<Value> Close(const Arguments& args) {
     HandleScope scope;
 
@@ -307,18 +519,80 @@ class ZipLib : ObjectWrap {
     HandleScope scope;
 
     Self *self = ObjectWrap::Unwrap<Self>(args.This());
+    self->CancelRequests();
     Request *request = Request::Destroy(self);
     return self->PushRequest(request);
   }
 
 
+  static Handle<Value> Stats(const Arguments& args) {
+    HandleScope scope;
+
+    Self *self = ObjectWrap::Unwrap<Self>(args.This());
+    return scope.Close(self->stats_.ToObject());
+  }
+
+
+  // setIdleTimeout(ms): after ms without requests, release library state
+  // of codecs supporting it (see DoHibernate), 0 turns it off.
+  static Handle<Value> SetIdleTimeout(const Arguments& args) {
+    HandleScope scope;
+
+    if (args.Length() < 1 || !args[0]->IsNumber() ||
+        args[0]->NumberValue() < 0) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("timeout must be a non-negative number"));
+      return ThrowException(exception);
+    }
+
+    Self *self = ObjectWrap::Unwrap<Self>(args.This());
+    self->idle_timeout_ = args[0]->NumberValue() / 1000;
+    self->StopIdleTimer();
+    if (self->tail_req_ == 0) {
+      self->StartIdleTimer();
+    }
+    return Undefined();
+  }
+
+
+  // Returns a new object continuing from the state of this one.  Codecs
+  // able to clone their state specialize it.
+  static Handle<Value> Fork(const Arguments& args) {
+    Local<Value> exception = Exception::Error(
+        String::New("fork() is not supported by this codec"));
+    return ThrowException(exception);
+  }
+
+
  private:
   void SchedRequest (Request *request) {
     DEBUG_P("%p Scheduling [%p,%d]", this, request, request->kind());
+    if (request->traced()) {
+      request->span().scheduled = NowNs();
+    }
     eio_custom(Self::DoProcess, EIO_PRI_DEFAULT,
                Self::DoHandleCallbacks, request);
     ev_ref(EV_DEFAULT_UC);
     Ref();
+    active_req_ = request;
+  }
+
+  // Cancels queued requests, releasing their input at once, and stops the
+  // running one at the next slice of its input.  Their callbacks get
+  // cancellation error, in order, when the running one completes.
+  // Executed in V8 thread.
+  void CancelRequests() {
+    if (tail_req_ == 0) {
+      return;
+    }
+    DEBUG_P("%p Cancelling from [%p,%d]", this, active_req_,
+        active_req_->kind());
+    codec_.Cancel();
+    active_req_->Cancel();
+    for (Request *r = active_req_->next(); r != 0; r = r->next()) {
+      r->Cancel();
+      r->ReleaseInput();
+    }
   }
 
   // Attempt to push request.  If we can't schedule it immediately, add it to
@@ -329,6 +603,11 @@ class ZipLib : ObjectWrap {
     if (request == 0) {
       return ThrowGentleOom();
     }
+    StopIdleTimer();
+    request->setQueuedAt(NowNs());
+    if (Tracer::Enabled()) {
+      request->span().enqueued = request->queuedAt();
+    }
 
     if (tail_req_) {
       DEBUG_P("%p Delaying Request [%p,%d]", this, request, request->kind());
@@ -353,70 +632,184 @@ class ZipLib : ObjectWrap {
 
   void DoProcess(Request *request) {
     DEBUG_P("strm:%p Processing [%p,%d]", this, request, request->kind());
+    uint64_t start = NowNs();
+    Count(&CodecStats::queue_wait_ns, start - request->queuedAt());
+    Count(&CodecStats::requests, 1);
+
     switch (request->kind()) {
       case Request::RWrite:
-        request->setStatus(
-            this->Write(request->buffer(), request->length(),
+        request->setStatus(request->count() > 0 ? WritePieces(request) :
+            codec_.Write(request->buffer(), request->length(),
               request->output(), request->flush()));
+        Count(&CodecStats::bytes_in, request->length());
+        Count(&CodecStats::write_ns, NowNs() - start);
         break;
 
       case Request::RClose:
-        request->setStatus(this->Close(request->output()));
+        request->setStatus(codec_.Close(request->output()));
+        Count(&CodecStats::finish_ns, NowNs() - start);
         break;
 
       case Request::RDestroy:
-        this->Destroy();
+        codec_.Destroy();
         request->setStatus(Utils::StatusOk());
         break;
+
+      case Request::RHibernate:
+        DoHibernate(request);
+        break;
+    }
+
+    Count(&CodecStats::codec_calls, codec_.TakeCalls());
+    Count(&CodecStats::bytes_out, request->output().length());
+    Count(&CodecStats::reallocs, request->output().reallocs());
+    if (Utils::IsError(request->status())) {
+      stats_.AddError(request->status());
+      codec_stats_.AddError(request->status());
+    }
+
+    if (request->traced()) {
+      request->span().started = start;
+      request->span().finished = NowNs();
+      request->span().thread = (unsigned long)pthread_self();
+    }
+  }
+
+  // Feeds gather write input to the codec in order, into one output.
+  // Executed in worker thread.
+  int WritePieces(Request *request) {
+    int ret = Utils::StatusOk();
+    for (int i = 0; i < request->count(); ++i) {
+      const typename Request::Piece &piece = request->pieces()[i];
+      bool last = i == request->count() - 1;
+      ret = codec_.Write(piece.data, piece.length, request->output(),
+          last && request->flush());
+      if (Utils::IsError(ret) || ret == Utils::StatusEndOfStream()) {
+        break;
+      }
+    }
+    return ret;
+  }
+
+
+  // Releases library state of an idle stream.  Codecs able to restore it
+  // on the next write specialize it, others keep their state.
+  void DoHibernate(Request *request) {
+    request->setStatus(Utils::StatusOk());
+  }
+
+
+  // Idle timer is armed while no requests are queued and doesn't keep the
+  // event loop alive.
+  // Executed in V8 thread.
+  void StartIdleTimer() {
+    if (idle_timeout_ > 0 && codec_.state() == Stream::Data) {
+      ev_timer_set(&idle_timer_, idle_timeout_, 0.);
+      ev_timer_start(EV_DEFAULT_UC_ &idle_timer_);
+      ev_unref(EV_DEFAULT_UC);
     }
+  }
+
 
+  void StopIdleTimer() {
+    if (ev_is_active(&idle_timer_)) {
+      ev_ref(EV_DEFAULT_UC);
+      ev_timer_stop(EV_DEFAULT_UC_ &idle_timer_);
+    }
+  }
+
+
+  static void OnIdle(EV_P_ ev_timer *watcher, int revents) {
+    Self *self = static_cast<Self*>(watcher->data);
+    ev_ref(EV_DEFAULT_UC);
+    self->PushRequest(Request::Hibernate(self));
+  }
+
+
+  // Update both per-stream and per-codec counters.
+  void Count(volatile uint64_t CodecStats::*counter, uint64_t value) {
+    CodecStats::Add(stats_.*counter, value);
+    CodecStats::Add(codec_stats_.*counter, value);
   }
 
   // Handle callbacks, potentially scheduling another Request from the tail-queue.
+  // Next request is dispatched before the callback runs, so the codec works
+  // on it while JS consumes this output; outputs are per request, so their
+  // order is kept.  Requests pushed by the callback queue behind it.
   // Executed in V8 threads.
   static int DoHandleCallbacks(eio_req *req) {
     DEBUG_P("DoHandleCallbacks");
     Request *request = reinterpret_cast<Request*>(req->data);
 
     Self *self = request->self();
-    DEBUG_P("%p Callback [%p]", self, request);
-    self->DoCallback(request->callback(),
-                     request->status(), request->output());
-
-    // do this *after* the callback since the CB *could have* scheduled another request
     Request *next = request->next();
 
+    // Flushing write ends the stream, requests queued after it are dropped
+    // with empty callbacks after this one's.
+    Request *dropped = 0;
     if (request->flush()) {
       DEBUG_P("%p Destroy via Callback", self);
-      self->Destroy();
+      self->codec_.Destroy();
+      dropped = next;
+      next = 0;
+    } else if (next != 0 && next->cancelled()) {
+      // Cancelled by destroy(), which queued its own request after them.
+      Request *last = next;
+      while (last->next() != 0 && last->next()->cancelled()) {
+        last = last->next();
+      }
+      dropped = next;
+      next = last->next();
+      last->setNext(0);
+    }
 
-      while (next) {
-        DEBUG_P("%p Found invalidated pending Request [%p,%d]", self, next, next->kind());
+    if (next) {
+      DEBUG_P("%p Found pending Request req:[%p,%d] next:[%p,%d]", self, request, request->kind(), next, next->kind());
+      self->SchedRequest(next);
+    } else {
+      DEBUG_P("%p No pending Requests", self);
+      self->tail_req_ = 0;
+      self->active_req_ = 0;
+      if (request->kind() != Request::RHibernate) {
+        self->StartIdleTimer();
+      }
+    }
+
+    DEBUG_P("%p Callback [%p]", self, request);
+    if (request->cancelled()) {
+      self->DoCancelled(request->callback());
+    } else {
+      self->DoCallback(request->callback(),
+                       request->status(), request->output());
+    }
+    if (request->traced()) {
+      request->span().done = NowNs();
+      Tracer::Commit(Processor::Name, self, request->kind(), request->span());
+    }
 
+    while (dropped) {
+      DEBUG_P("%p Found invalidated pending Request [%p,%d]", self, dropped, dropped->kind());
+      Request *following = dropped->next();
+
+      if (dropped->cancelled()) {
+        self->DoCancelled(dropped->callback());
+      } else if (!dropped->callback().IsEmpty()) {
         HandleScope scope;
         TryCatch try_catch;
         Local<Value> argv[2];
         argv[0] = Local<Value>::New(Undefined());
         argv[1] = Local<Value>::New(Undefined());
-        next->callback()->Call(Context::GetCurrent()->Global(), 2, argv);
+        dropped->callback()->Call(Context::GetCurrent()->Global(), 2, argv);
         if (try_catch.HasCaught()) {
           FatalException(try_catch);
         }
-        delete next;
-
-        next = next->next();
       }
+      delete dropped;
+      dropped = following;
     }
 
-    if (next) {
-      DEBUG_P("%p Found pending Request req:[%p,%d] next:[%p,%d]", self, request, request->kind(), next, next->kind());
-      self->SchedRequest(next);
-    } else {
-      DEBUG_P("%p No pending Requests", self);
-      self->tail_req_ = 0;
-    }
-
-    // unref/free should happen *after* we schedule next (if present)
+    // unref/free should happen *after* the callback, which may still use
+    // the object.
     self->Unref();
     delete request;
     // Unref counter triggered by request.
@@ -425,6 +818,24 @@ class ZipLib : ObjectWrap {
     return 0;
   }
 
+  // Reports cancellation by destroy(), output of the request is dropped.
+  void DoCancelled(Persistent<Function> cb) {
+    if (!cb.IsEmpty()) {
+      HandleScope scope;
+
+      Local<Value> argv[2];
+      argv[0] = Exception::Error(String::New("Request cancelled"));
+      argv[1] = Local<Value>::New(Undefined());
+      TryCatch try_catch;
+
+      cb->Call(Context::GetCurrent()->Global(), 2, argv);
+
+      if (try_catch.HasCaught()) {
+        FatalException(try_catch);
+      }
+    }
+  }
+
   void DoCallback(Persistent<Function> cb, int r, Blob &out) {
     DEBUG_P("%p r:%d", this, r);
     if (!cb.IsEmpty()) {
@@ -440,11 +851,7 @@ class ZipLib : ObjectWrap {
         if(!buffer.IsEmpty())  {
           Buffer *slowBuffer = ObjectWrap::Unwrap<Buffer>(buffer);
           if(out.length() > 0) memcpy(node::Buffer::Data(slowBuffer), out.data(), out.length());
-          Handle<Value> constructorArgs[3];
-          constructorArgs[0] = slowBuffer->handle_;
-          constructorArgs[1] = Integer::New(out.length());
-          constructorArgs[2] = Integer::New(0);
-          argv[1] = Self::buffer_constructor_->NewInstance(3, constructorArgs);
+          argv[1] = MakeBuffer(slowBuffer, 0, out.length());
         }
       }
       else {
@@ -463,8 +870,10 @@ class ZipLib : ObjectWrap {
  private:
 
   ZipLib()
-    : ObjectWrap(), state_(Self::Idle)
+    : ObjectWrap(), active_req_(0), idle_timeout_(0)
   {
+    ev_init(&idle_timer_, OnIdle);
+    idle_timer_.data = this;
   }
 
 
@@ -472,87 +881,12 @@ class ZipLib : ObjectWrap {
 #ifdef DEBUG
     DEBUG_P("destroy [%d]", ++Self::destroy_count_);
 #endif
-    this->Destroy();
-  }
-
-
-  int Write(char *data, int dataLength, Blob &out, bool flush) {
-    DEBUG_P("%p",this);
-    COND_RETURN(state_ != Self::Data, Utils::StatusSequenceError());
-
-    Transition t(state_, Self::Error);
-
-    data += dataLength;
-    int ret = Utils::StatusOk();
-    while (dataLength > 0) { 
-      COND_RETURN(!out.GrowBy(dataLength + 1), Utils::StatusMemoryError());
-      
-      ret = this->processor_.Write(data - dataLength, dataLength, out, flush);
-      if(flush) Finish(out);
-
-      COND_RETURN(Utils::IsError(ret), ret);
-      if (ret == Utils::StatusEndOfStream()) {
-        t.alter(Self::Eos);
-        return ret;
-      }
-    }
-    t.abort();
-    if(flush) {
-      Finish(out);
-      this->Destroy();
-    }
-    return Utils::StatusOk();
-  }
-
-
-  int Close(Blob &out) {
-    DEBUG_P("%p",this);
-    COND_RETURN(state_ == Self::Idle || state_ == Self::Destroyed,
-        Utils::StatusOk());
-
-    Transition t(state_, Self::Error);
-
-    int ret = Utils::StatusOk();
-    if (state_ == Self::Data) {
-      ret = Finish(out);
-    }
-
-    t.abort();
-    this->Destroy();
-    return ret;
-  }
-
-
-  void Destroy() {
-    DEBUG_P("%p",this);
-    if (state_ != Self::Idle && state_ != Self::Destroyed) {
-      this->processor_.Destroy();
-    }
-    state_ = Self::Destroyed;
-  }
-
-  int Finish(Blob &out) {
-    const int Chunk = 4096;
-
-    int ret;
-    do {
-      COND_RETURN(!out.GrowBy(Chunk), Utils::StatusMemoryError());
-
-      ret = this->processor_.Finish(out);
-      COND_RETURN(Utils::IsError(ret), ret);
-    } while (ret != Utils::StatusEndOfStream());
-    return Utils::StatusOk();
+    StopIdleTimer();
+    codec_.Destroy();
   }
 
 
  private:
-  static Handle<Value> ThrowGentleOom() {
-    V8::LowMemoryNotification();
-    Local<Value> exception = Exception::Error(
-        String::New("Insufficient space"));
-    return ThrowException(exception);
-  }
-
   static Handle<Value> ThrowCallbackExpected() {
     Local<Value> exception = Exception::TypeError(
         String::New("Callback must be a function"));
@@ -561,20 +895,25 @@ class ZipLib : ObjectWrap {
 
 
  private:
-  Processor processor_;
-  State state_;
+  Stream codec_;
   Request *tail_req_;
+  // Request running in worker thread, valid while tail_req_ is set.
+  Request *active_req_;
+  CodecStats stats_;
+
+  ev_timer idle_timer_;
+  ev_tstamp idle_timeout_;
 
+  static CodecStats codec_stats_;
   static Persistent<FunctionTemplate> constructor_;
-  static Persistent<Function> buffer_constructor_;
   static Persistent<Function> slow_buffer_constructor_;
 #ifdef DEBUG
   static int destroy_count_;
 #endif
 };
 
+template <class T> CodecStats ZipLib<T>::codec_stats_;
 template <class T> Persistent<FunctionTemplate> ZipLib<T>::constructor_;
-template <class T> Persistent<Function> ZipLib<T>::buffer_constructor_;
 template <class T> Persistent<Function> ZipLib<T>::slow_buffer_constructor_;
 #ifdef DEBUG
 template <class T> int ZipLib<T>::destroy_count_ = 0;
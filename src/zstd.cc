@@ -0,0 +1,571 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <node.h>
+#include <node_events.h>
+#include <node_buffer.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <zstd.h>
+#include <zstd_errors.h>
+
+#include "utils.h"
+#include "zlib.h"
+
+using namespace v8;
+using namespace node;
+
+class ZstdUtils {
+ public:
+  typedef ScopedBlob Blob;
+
+  enum Status {
+    Ok = 0,
+    StreamEnd = 1,
+    SequenceError = -1,
+    MemError = -2,
+    DataError = -3,
+    UnexpectedEof = -4,
+    ParamError = -5,
+    DictionaryError = -6,
+    WindowTooLarge = -7,
+    LibraryError = -8
+  };
+
+ public:
+  static int StatusOk() {
+    return Ok;
+  }
+
+
+  static int StatusSequenceError() {
+    return SequenceError;
+  }
+
+
+  static int StatusMemoryError() {
+    return MemError;
+  }
+
+
+  static int StatusEndOfStream() {
+    return StreamEnd;
+  }
+
+ public:
+  static bool IsError(int zstdStatus) {
+    return zstdStatus < 0;
+  }
+
+
+  // Map size_t result of zstd function to status.
+  static int FromResult(size_t result) {
+    if (!ZSTD_isError(result)) {
+      return Ok;
+    }
+    switch (ZSTD_getErrorCode(result)) {
+      case ZSTD_error_memory_allocation:
+        return MemError;
+      case ZSTD_error_stage_wrong:
+      case ZSTD_error_init_missing:
+        return SequenceError;
+      case ZSTD_error_parameter_unsupported:
+      case ZSTD_error_parameter_combination_unsupported:
+      case ZSTD_error_parameter_outOfBound:
+        return ParamError;
+      case ZSTD_error_dictionary_corrupted:
+      case ZSTD_error_dictionary_wrong:
+      case ZSTD_error_dictionaryCreation_failed:
+        return DictionaryError;
+      case ZSTD_error_frameParameter_windowTooLarge:
+        return WindowTooLarge;
+      case ZSTD_error_prefix_unknown:
+      case ZSTD_error_version_unsupported:
+      case ZSTD_error_frameParameter_unsupported:
+      case ZSTD_error_corruption_detected:
+      case ZSTD_error_checksum_wrong:
+      case ZSTD_error_literals_headerWrong:
+        return DataError;
+
+      default:
+        return LibraryError;
+    }
+  }
+
+
+  static Local<Value> GetException(int zstdStatus) {
+    if (!IsError(zstdStatus)) {
+      return Local<Value>::New(Undefined());
+    } else {
+      switch (zstdStatus) {
+        case SequenceError:
+          return Exception::Error(String::New(SequenceErrorMessage));
+        case MemError:
+          return Exception::Error(String::New(MemErrorMessage));
+        case DataError:
+          return Exception::Error(String::New(DataErrorMessage));
+        case UnexpectedEof:
+          return Exception::Error(String::New(UnexpectedEofMessage));
+        case ParamError:
+          return Exception::Error(String::New(ParamErrorMessage));
+        case DictionaryError:
+          return Exception::Error(String::New(DictionaryErrorMessage));
+        case WindowTooLarge:
+          return Exception::Error(String::New(WindowTooLargeMessage));
+        case LibraryError:
+          return Exception::Error(String::New(LibraryErrorMessage));
+
+        default:
+          return Exception::Error(String::New("Unknown error"));
+      }
+    }
+  }
+
+ private:
+  static const char SequenceErrorMessage[];
+  static const char MemErrorMessage[];
+  static const char DataErrorMessage[];
+  static const char UnexpectedEofMessage[];
+  static const char ParamErrorMessage[];
+  static const char DictionaryErrorMessage[];
+  static const char WindowTooLargeMessage[];
+  static const char LibraryErrorMessage[];
+};
+const char ZstdUtils::SequenceErrorMessage[] = "Call sequence error.";
+const char ZstdUtils::MemErrorMessage[] = "Out of memory.";
+const char ZstdUtils::DataErrorMessage[] = "Input data corrupted.";
+const char ZstdUtils::UnexpectedEofMessage[] = "Unexpected end of input.";
+const char ZstdUtils::ParamErrorMessage[] = "Invalid or unsupported "
+  "parameter.";
+const char ZstdUtils::DictionaryErrorMessage[] = "Dictionary is corrupted or "
+  "doesn't match.";
+const char ZstdUtils::WindowTooLargeMessage[] = "Frame requires larger "
+  "window than allowed by windowLogMax.";
+const char ZstdUtils::LibraryErrorMessage[] = "Zstandard library error.";
+
+
+// Digested dictionary shared by any number of streams.  Streams keep it
+// alive with reference counting, since they release it from worker threads
+// and may outlive the JS object.
+class ZstdSharedDictionary {
+ public:
+  static ZstdSharedDictionary* New(const char *data, size_t length,
+      int level) {
+    ZstdSharedDictionary *dict = new(std::nothrow) ZstdSharedDictionary();
+    if (dict == 0) {
+      return 0;
+    }
+    dict->cdict_ = ZSTD_createCDict(data, length, level);
+    dict->ddict_ = ZSTD_createDDict(data, length);
+    if (dict->cdict_ == 0 || dict->ddict_ == 0) {
+      dict->Unref();
+      return 0;
+    }
+    return dict;
+  }
+
+  void Ref() {
+    __sync_fetch_and_add(&refs_, 1);
+  }
+
+  void Unref() {
+    if (__sync_sub_and_fetch(&refs_, 1) == 0) {
+      delete this;
+    }
+  }
+
+  const ZSTD_CDict *cdict() const {
+    return cdict_;
+  }
+
+  const ZSTD_DDict *ddict() const {
+    return ddict_;
+  }
+
+ private:
+  ZstdSharedDictionary()
+    : refs_(1), cdict_(0), ddict_(0)
+  {}
+
+  ~ZstdSharedDictionary() {
+    ZSTD_freeCDict(cdict_);
+    ZSTD_freeDDict(ddict_);
+  }
+
+ private:
+  volatile int refs_;
+  ZSTD_CDict *cdict_;
+  ZSTD_DDict *ddict_;
+};
+
+
+// ZstdDictionary(buffer [, level]): JS handle of a prepared dictionary.
+class ZstdDictionary : ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    constructor_ = Persistent<FunctionTemplate>::New(
+        FunctionTemplate::New(New));
+    constructor_->InstanceTemplate()->SetInternalFieldCount(1);
+
+    target->Set(String::NewSymbol("ZstdDictionary"),
+        constructor_->GetFunction());
+  }
+
+  // Returns referenced dictionary if value is ZstdDictionary, 0 otherwise.
+  static ZstdSharedDictionary* Get(Handle<Value> value) {
+    if (!value->IsObject() || !constructor_->HasInstance(value)) {
+      return 0;
+    }
+    ZstdDictionary *self = ObjectWrap::Unwrap<ZstdDictionary>(
+        value->ToObject());
+    self->dict_->Ref();
+    return self->dict_;
+  }
+
+ private:
+  static Handle<Value> New(const Arguments &args) {
+    HandleScope scope;
+
+    if (args.Length() < 1 || !Buffer::HasInstance(args[0])) {
+      Local<Value> exception = Exception::TypeError(
+          String::New("Dictionary must be of type Buffer"));
+      return ThrowException(exception);
+    }
+    int level = ZSTD_CLEVEL_DEFAULT;
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+      if (!args[1]->IsInt32()) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("level must be an integer"));
+        return ThrowException(exception);
+      }
+      level = args[1]->Int32Value();
+    }
+
+    Local<Object> buffer = args[0]->ToObject();
+    ZstdSharedDictionary *dict = ZstdSharedDictionary::New(
+        Buffer::Data(buffer), Buffer::Length(buffer), level);
+    if (dict == 0) {
+      return ThrowException(
+          ZstdUtils::GetException(ZstdUtils::DictionaryError));
+    }
+
+    ZstdDictionary *self = new(std::nothrow) ZstdDictionary(dict);
+    if (self == 0) {
+      dict->Unref();
+      return ThrowException(ZstdUtils::GetException(ZstdUtils::MemError));
+    }
+    self->Wrap(args.This());
+    return args.This();
+  }
+
+  explicit ZstdDictionary(ZstdSharedDictionary *dict)
+    : ObjectWrap(), dict_(dict)
+  {}
+
+  ~ZstdDictionary() {
+    dict_->Unref();
+  }
+
+ private:
+  ZstdSharedDictionary *dict_;
+
+  static Persistent<FunctionTemplate> constructor_;
+};
+Persistent<FunctionTemplate> ZstdDictionary::constructor_;
+
+
+class ZstdImpl {
+#ifdef NEED_PUBLIC_FRIEND
+ public:
+#endif
+  friend class ZipLib<ZstdImpl>;
+  friend class Codec<ZstdImpl>;
+
+  typedef ZstdUtils Utils;
+  typedef ZstdUtils::Blob Blob;
+
+ private:
+  static const char Name[];
+
+ private:
+  // Zstd(level, use_buffers, windowLog, longDistance, workers, dictionary)
+  Handle<Value> Init(const Arguments &args) {
+    HandleScope scope;
+
+    int params[3] = { ZSTD_CLEVEL_DEFAULT, 0, 0 };
+    static const char *names[3] = { "level", "windowLog", "workers" };
+    static const int positions[3] = { 0, 2, 4 };
+
+    want_buffer_ = false;
+    ctx_ = 0;
+    dict_ = 0;
+
+    for (int i = 0; i < 3; ++i) {
+      int arg = positions[i];
+      if (args.Length() > arg && !args[arg]->IsUndefined()) {
+        if (!args[arg]->IsInt32()) {
+          char message[64];
+          snprintf(message, sizeof(message), "%s must be an integer",
+              names[i]);
+          Local<Value> exception = Exception::TypeError(String::New(message));
+          return ThrowException(exception);
+        }
+        params[i] = args[arg]->Int32Value();
+      }
+    }
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+      want_buffer_ = args[1]->BooleanValue() ? true : false;
+    }
+    bool longDistance = args.Length() > 3 && args[3]->BooleanValue();
+    if (args.Length() > 5 && !args[5]->IsUndefined()) {
+      dict_ = ZstdDictionary::Get(args[5]);
+      if (dict_ == 0) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("dictionary must be a ZstdDictionary"));
+        return ThrowException(exception);
+      }
+    }
+
+    int ret = InitStream(params[0], params[1], longDistance, params[2]);
+    if (Utils::IsError(ret)) {
+      return ThrowException(Utils::GetException(ret));
+    }
+    return Undefined();
+  }
+
+
+  int Init(int level) {
+    want_buffer_ = true;
+    dict_ = 0;
+    return InitStream(level < 0 ? ZSTD_CLEVEL_DEFAULT : level, 0, false, 0);
+  }
+
+
+  // Zero windowLog means default for the level, zero workers means
+  // compression in the calling thread.
+  int InitStream(int level, int windowLog, bool longDistance, int workers) {
+    done_ = false;
+    ctx_ = ZSTD_createCCtx();
+    COND_RETURN(ctx_ == 0, Utils::MemError);
+
+    int ret = Utils::FromResult(
+        ZSTD_CCtx_setParameter(ctx_, ZSTD_c_compressionLevel, level));
+    if (!Utils::IsError(ret) && windowLog) {
+      ret = Utils::FromResult(
+          ZSTD_CCtx_setParameter(ctx_, ZSTD_c_windowLog, windowLog));
+    }
+    if (!Utils::IsError(ret) && longDistance) {
+      ret = Utils::FromResult(ZSTD_CCtx_setParameter(
+            ctx_, ZSTD_c_enableLongDistanceMatching, 1));
+    }
+    if (!Utils::IsError(ret) && workers) {
+      ret = Utils::FromResult(
+          ZSTD_CCtx_setParameter(ctx_, ZSTD_c_nbWorkers, workers));
+    }
+    if (!Utils::IsError(ret)) {
+      ret = Utils::FromResult(ZSTD_CCtx_setParameter(
+            ctx_, ZSTD_c_checksumFlag, 1));
+    }
+    if (!Utils::IsError(ret) && dict_) {
+      ret = Utils::FromResult(ZSTD_CCtx_refCDict(ctx_, dict_->cdict()));
+    }
+    return ret;
+  }
+
+
+  int Write(char *data, size_t &dataLength, Blob &out, bool flush) {
+    out.setUseBufferOut(want_buffer_);
+
+    ZSTD_inBuffer input = { data, dataLength, 0 };
+    ZSTD_outBuffer output = { out.data() + out.length(), out.avail(), 0 };
+    size_t result = ZSTD_compressStream2(ctx_, &output, &input,
+        ZSTD_e_continue);
+    int ret = Utils::FromResult(result);
+    if (!Utils::IsError(ret)) {
+      dataLength -= input.pos;
+      out.IncreaseLengthBy(output.pos);
+    }
+    return ret;
+  }
+
+
+  int Finish(Blob &out) {
+    out.setUseBufferOut(want_buffer_);
+    COND_RETURN(done_, Utils::StreamEnd);
+
+    // Multithreaded compressor may hold several jobs of output.
+    if (out.avail() < ZSTD_CStreamOutSize()) {
+      COND_RETURN(!out.GrowBy(ZSTD_CStreamOutSize()), Utils::MemError);
+    }
+
+    ZSTD_inBuffer input = { NULL, 0, 0 };
+    ZSTD_outBuffer output = { out.data() + out.length(), out.avail(), 0 };
+    size_t remaining = ZSTD_compressStream2(ctx_, &output, &input,
+        ZSTD_e_end);
+    int ret = Utils::FromResult(remaining);
+    COND_RETURN(Utils::IsError(ret), ret);
+
+    out.IncreaseLengthBy(output.pos);
+    done_ = remaining == 0;
+    return done_ ? Utils::StreamEnd : Utils::Ok;
+  }
+
+
+  void Destroy() {
+    ZSTD_freeCCtx(ctx_);
+    ctx_ = 0;
+    if (dict_) {
+      dict_->Unref();
+      dict_ = 0;
+    }
+  }
+
+ private:
+  bool want_buffer_;
+  bool done_;
+  ZSTD_CCtx *ctx_;
+  ZstdSharedDictionary *dict_;
+};
+const char ZstdImpl::Name[] = "Zstd";
+typedef ZipLib<ZstdImpl> Zstd;
+
+
+class UnzstdImpl {
+#ifdef NEED_PUBLIC_FRIEND
+ public:
+#endif
+  friend class ZipLib<UnzstdImpl>;
+  friend class Codec<UnzstdImpl>;
+
+  typedef ZstdUtils Utils;
+  typedef ZstdUtils::Blob Blob;
+
+ private:
+  static const char Name[];
+
+ private:
+  // Unzstd(use_buffers, windowLogMax, dictionary)
+  Handle<Value> Init(const Arguments &args) {
+    HandleScope scope;
+
+    int windowLogMax = 0;
+    want_buffer_ = false;
+    ctx_ = 0;
+    dict_ = 0;
+
+    if (args.Length() > 0 && !args[0]->IsUndefined()) {
+      want_buffer_ = args[0]->BooleanValue() ? true : false;
+    }
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+      if (!args[1]->IsInt32()) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("windowLogMax must be an integer"));
+        return ThrowException(exception);
+      }
+      windowLogMax = args[1]->Int32Value();
+    }
+    if (args.Length() > 2 && !args[2]->IsUndefined()) {
+      dict_ = ZstdDictionary::Get(args[2]);
+      if (dict_ == 0) {
+        Local<Value> exception = Exception::TypeError(
+            String::New("dictionary must be a ZstdDictionary"));
+        return ThrowException(exception);
+      }
+    }
+
+    int ret = InitStream(windowLogMax);
+    if (Utils::IsError(ret)) {
+      return ThrowException(Utils::GetException(ret));
+    }
+    return Undefined();
+  }
+
+
+  int Init(int level) {
+    want_buffer_ = true;
+    dict_ = 0;
+    return InitStream(0);
+  }
+
+
+  int InitStream(int windowLogMax) {
+    pending_ = false;
+    ctx_ = ZSTD_createDCtx();
+    COND_RETURN(ctx_ == 0, Utils::MemError);
+
+    int ret = Utils::Ok;
+    if (windowLogMax) {
+      ret = Utils::FromResult(
+          ZSTD_DCtx_setParameter(ctx_, ZSTD_d_windowLogMax, windowLogMax));
+    }
+    if (!Utils::IsError(ret) && dict_) {
+      ret = Utils::FromResult(ZSTD_DCtx_refDDict(ctx_, dict_->ddict()));
+    }
+    return ret;
+  }
+
+
+  // Frames following the first one are decoded too, as `zstd -d' does,
+  // so stream ends only with the input.
+  int Write(char *data, size_t &dataLength, Blob &out, bool flush) {
+    out.setUseBufferOut(want_buffer_);
+
+    ZSTD_inBuffer input = { data, dataLength, 0 };
+    ZSTD_outBuffer output = { out.data() + out.length(), out.avail(), 0 };
+    size_t hint = ZSTD_decompressStream(ctx_, &output, &input);
+    int ret = Utils::FromResult(hint);
+    COND_RETURN(Utils::IsError(ret), ret);
+
+    dataLength -= input.pos;
+    out.IncreaseLengthBy(output.pos);
+    pending_ = hint != 0;
+    return Utils::Ok;
+  }
+
+
+  // Input ending inside a frame is truncated.
+  int Finish(Blob &out) {
+    out.setUseBufferOut(want_buffer_);
+    return pending_ ? Utils::UnexpectedEof : Utils::StreamEnd;
+  }
+
+
+  void Destroy() {
+    ZSTD_freeDCtx(ctx_);
+    ctx_ = 0;
+    if (dict_) {
+      dict_->Unref();
+      dict_ = 0;
+    }
+  }
+
+ private:
+  bool want_buffer_;
+  bool pending_;
+  ZSTD_DCtx *ctx_;
+  ZstdSharedDictionary *dict_;
+};
+const char UnzstdImpl::Name[] = "Unzstd";
+typedef ZipLib<UnzstdImpl> Unzstd;
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+// Gather write totalling more than 4 GB, then streamed decompression
+// checking length and content of the output.  Needs about 1.5 GB of memory.
+// Run with `node test/large-write-test.js' after building.
+
+var compress = require("../lib/compress");
+var assert = require("assert");
+var Buffer = require('buffer').Buffer;
+
+var PieceLength = 512 * 1024 * 1024;
+var Pieces = 9;
+var ChunkLength = 256 * 1024;
+
+var piece = new Buffer(PieceLength);
+for (var i = 0; i < PieceLength; ++i) {
+  piece[i] = i & 0xff;
+}
+var pieces = [];
+for (var i = 0; i < Pieces; ++i) {
+  pieces.push(piece);
+}
+
+var gzip = new compress.Gzip(1, true);
+gzip.write(pieces, true, function(exc, compressed) {
+  assert.ifError(exc);
+  piece = pieces = null;
+
+  // Chunks of compressed input keep each output Buffer small.
+  var gunzip = new compress.Gunzip(true);
+  var total = 0;
+  function received(output) {
+    if (output && output.length > 0) {
+      assert.equal(output[0], total & 0xff);
+      assert.equal(output[output.length - 1],
+          (total + output.length - 1) & 0xff);
+      total += output.length;
+    }
+  }
+
+  var offset = 0;
+  function next() {
+    if (offset >= compressed.length) {
+      gunzip.close(function(exc, output) {
+        assert.ifError(exc);
+        received(output);
+        assert.equal(total, PieceLength * Pieces);
+        console.log('ok');
+      });
+      return;
+    }
+    var end = Math.min(offset + ChunkLength, compressed.length);
+    gunzip.write(compressed.slice(offset, end), function(exc, output) {
+      assert.ifError(exc);
+      received(output);
+      next();
+    });
+    offset = end;
+  }
+  next();
+});
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2026, node-compress contributors.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+// Round trip of permessage-deflate messages, empty ones included.
+// Run with `node test/message-test.js' after building.
+
+var compress = require("../lib/compress");
+var assert = require("assert");
+var Buffer = require('buffer').Buffer;
+
+var messages = ['hello', '', 'hello hello', '', ''];
+var buffers = messages.map(function(m) { return new Buffer(m); });
+
+function check(contextTakeover, done) {
+  var deflate = new compress.MessageDeflate(
+      {contextTakeover: contextTakeover});
+  var inflate = new compress.MessageInflate(
+      {contextTakeover: contextTakeover});
+
+  deflate.writeMessages(buffers, function(exc, compressed) {
+    assert.ifError(exc);
+    assert.equal(compressed.length, messages.length);
+    compressed.forEach(function(c) {
+      // Empty message is at least an empty stored block (RFC 7692 7.2.3.6).
+      assert.ok(c.length > 0);
+    });
+
+    inflate.writeMessages(compressed, function(exc, plain) {
+      assert.ifError(exc);
+      assert.deepEqual(plain.map(function(p) { return p.toString(); }),
+          messages);
+
+      // Message after the empty ones still decodes.
+      deflate.write(new Buffer('after'), function(exc, c) {
+        assert.ifError(exc);
+        inflate.write(c, function(exc, p) {
+          assert.ifError(exc);
+          assert.equal(p.toString(), 'after');
+          deflate.close();
+          inflate.close();
+          done();
+        });
+      });
+    });
+  });
+}
+
+check(true, function() {
+  check(false, function() {
+    console.log('ok');
+  });
+});